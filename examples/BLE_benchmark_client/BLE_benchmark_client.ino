@@ -0,0 +1,219 @@
+/**
+ * Client side of the BLE throughput benchmark.  Run BLE_benchmark_server on a second ESP32.
+ *
+ * For each MTU in the list the client connects to the server and measures:
+ *
+ * - notify:        throughput of the notifications received, and how many were lost.
+ * - indicate:      throughput, and the server's percentiles of the time from sending an indication to its confirmation.
+ * - write:         throughput, and the percentiles of the time of a write with response.
+ * - write no rsp:  throughput of writes without response, as counted by the server.
+ *
+ * Latencies are in microseconds.  Throughputs are of the payload in bytes per second.
+ */
+#include "BLEDevice.h"
+#include <algorithm>
+#include <vector>
+
+static BLEUUID serviceUUID("6e7a0001-8c4e-4d59-9f9b-1b4a5f7c0e01");
+static BLEUUID controlUUID("6e7a0002-8c4e-4d59-9f9b-1b4a5f7c0e01");
+static BLEUUID  dataTxUUID("6e7a0003-8c4e-4d59-9f9b-1b4a5f7c0e01");
+static BLEUUID  dataRxUUID("6e7a0004-8c4e-4d59-9f9b-1b4a5f7c0e01");
+static BLEUUID  resultUUID("6e7a0005-8c4e-4d59-9f9b-1b4a5f7c0e01");
+
+#define OP_NOTIFY     0x01
+#define OP_INDICATE   0x02
+#define OP_RESET_RX   0x03
+
+static const uint16_t mtuSizes[] = { 23, 185, 247, 517 };
+static const uint16_t PACKET_COUNT = 500;
+static const uint32_t RECEIVE_TIMEOUT_MS = 20000;
+
+static BLEAddress *pServerAddress;
+static boolean doBenchmark = false;
+
+static BLERemoteCharacteristic* pControl;
+static BLERemoteCharacteristic* pDataTx;
+static BLERemoteCharacteristic* pDataRx;
+static BLERemoteCharacteristic* pResult;
+
+static volatile uint32_t rxPackets = 0;
+static volatile uint32_t rxBytes   = 0;
+static volatile uint32_t rxFirstUs = 0;
+static volatile uint32_t rxLastUs  = 0;
+static volatile uint32_t rxNextSeq = 0;
+static volatile uint32_t rxLost    = 0;
+
+static void dataCallback(
+  BLERemoteCharacteristic* pBLERemoteCharacteristic,
+  uint8_t* pData,
+  size_t length,
+  bool isNotify) {
+    uint32_t now = micros();
+    if (length < 4) {
+      return;
+    }
+    uint32_t seq;
+    memcpy(&seq, pData, sizeof(seq));
+    if (rxPackets == 0) {
+      rxFirstUs = now;
+    }
+    if (seq > rxNextSeq) {
+      rxLost += seq - rxNextSeq;
+    }
+    rxNextSeq = seq + 1;
+    rxLastUs  = now;
+    rxBytes  += length;
+    rxPackets++;
+}
+
+static uint32_t bytesPerSecond(uint32_t bytes, uint32_t us) {
+  return us == 0 ? 0 : (uint32_t)((uint64_t)bytes * 1000000 / us);
+}
+
+static uint32_t percentile(std::vector<uint32_t>& samples, int pct) {
+  if (samples.empty()) {
+    return 0;
+  }
+  size_t index = (samples.size() * pct) / 100;
+  if (index >= samples.size()) {
+    index = samples.size() - 1;
+  }
+  return samples[index];
+}
+
+static void sendCommand(uint8_t op, uint16_t count, uint16_t size) {
+  uint8_t command[5] = { op, (uint8_t)count, (uint8_t)(count >> 8), (uint8_t)size, (uint8_t)(size >> 8) };
+  pControl->writeValue(command, sizeof(command), true);
+}
+
+static void receiveRun(const char* name, uint8_t op, uint16_t size) {
+  rxPackets = 0;
+  rxBytes   = 0;
+  rxNextSeq = 0;
+  rxLost    = 0;
+  sendCommand(op, PACKET_COUNT, size);
+  uint32_t start = millis();
+  // Wait for the last packet, or for the stream to stop.
+  while (rxNextSeq < PACKET_COUNT && millis() - start < RECEIVE_TIMEOUT_MS) {
+    delay(10);
+  }
+  Serial.printf("  %-12s %7u bytes/s, %u packets received, %u lost\n", name,
+    bytesPerSecond(rxBytes, rxLastUs - rxFirstUs), rxPackets, rxLost);
+}
+
+static void writeRun(uint16_t size) {
+  std::vector<uint8_t> packet(size, 0x55);
+  std::vector<uint32_t> latencies;
+  latencies.reserve(PACKET_COUNT);
+
+  uint32_t start = micros();
+  for (uint32_t seq = 0; seq < PACKET_COUNT; seq++) {
+    memcpy(packet.data(), &seq, sizeof(seq));
+    uint32_t sent = micros();
+    pDataRx->writeValue(packet.data(), size, true);
+    latencies.push_back(micros() - sent);
+  }
+  uint32_t elapsed = micros() - start;
+  std::sort(latencies.begin(), latencies.end());
+  Serial.printf("  %-12s %7u bytes/s, p50=%u p90=%u p99=%u max=%u\n", "write",
+    bytesPerSecond((uint32_t)PACKET_COUNT * size, elapsed),
+    percentile(latencies, 50), percentile(latencies, 90), percentile(latencies, 99), latencies.back());
+}
+
+static void writeNoResponseRun(uint16_t size) {
+  std::vector<uint8_t> packet(size, 0xaa);
+  sendCommand(OP_RESET_RX, 0, 0);
+  for (uint32_t seq = 0; seq < PACKET_COUNT; seq++) {
+    memcpy(packet.data(), &seq, sizeof(seq));
+    pDataRx->writeValue(packet.data(), size, false);
+  }
+  delay(500);   // Let the last writes reach the server.
+  // The result reads "rx_bytes=<n> rx_packets=<n> rx_us=<n> ...".
+  std::string result = pResult->readValue();
+  uint32_t bytes = 0, packets = 0, us = 0;
+  sscanf(result.c_str(), "rx_bytes=%u rx_packets=%u rx_us=%u", &bytes, &packets, &us);
+  Serial.printf("  %-12s %7u bytes/s, %u of %u packets received\n", "write no rsp",
+    bytesPerSecond(bytes, us), packets, PACKET_COUNT);
+}
+
+static bool runBenchmark(BLEClient* pClient, uint16_t mtu) {
+  BLEDevice::setMTU(mtu);
+  if (!pClient->connect(*pServerAddress)) {
+    Serial.println("Failed to connect");
+    return false;
+  }
+  delay(500);   // Let the MTU exchange and data length negotiation complete.
+
+  BLERemoteService* pService = pClient->getService(serviceUUID);
+  if (pService == nullptr) {
+    Serial.println("Failed to find the benchmark service");
+    pClient->disconnect();
+    return false;
+  }
+  pControl = pService->getCharacteristic(controlUUID);
+  pDataTx  = pService->getCharacteristic(dataTxUUID);
+  pDataRx  = pService->getCharacteristic(dataRxUUID);
+  pResult  = pService->getCharacteristic(resultUUID);
+  if (pControl == nullptr || pDataTx == nullptr || pDataRx == nullptr || pResult == nullptr) {
+    Serial.println("Failed to find the benchmark characteristics");
+    pClient->disconnect();
+    return false;
+  }
+
+  pDataTx->registerForNotify(dataCallback);
+  uint8_t enable[2] = { 0x03, 0x00 };   // Enable both notifications and indications.
+  pDataTx->getDescriptor(BLEUUID((uint16_t)0x2902))->writeValue(enable, sizeof(enable), true);
+
+  uint16_t size = mtu - 3;
+  Serial.printf("MTU %u (payload %u bytes, data length %u):\n", mtu, size, pClient->getDataLength());
+
+  receiveRun("notify", OP_NOTIFY, size);
+  receiveRun("indicate", OP_INDICATE, size);
+  Serial.printf("  %-12s %s\n", "", pResult->readValue().c_str());
+  writeRun(size);
+  writeNoResponseRun(size);
+
+  pClient->disconnect();
+  delay(1000);
+  return true;
+}
+
+/**
+ * Scan for the first server that advertises the benchmark service.
+ */
+class AdvertisedDeviceCallbacks: public BLEAdvertisedDeviceCallbacks {
+  void onResult(BLEAdvertisedDevice advertisedDevice) {
+    if (advertisedDevice.haveServiceUUID() && advertisedDevice.getServiceUUID().equals(serviceUUID)) {
+      Serial.print("Found the benchmark server: ");
+      Serial.println(advertisedDevice.getAddress().toString().c_str());
+      advertisedDevice.getScan()->stop();
+      pServerAddress = new BLEAddress(advertisedDevice.getAddress());
+      doBenchmark = true;
+    }
+  }
+};
+
+
+void setup() {
+  Serial.begin(115200);
+  Serial.println("Starting the BLE benchmark client...");
+  BLEDevice::init("");
+
+  BLEScan* pBLEScan = BLEDevice::getScan();
+  pBLEScan->setAdvertisedDeviceCallbacks(new AdvertisedDeviceCallbacks());
+  pBLEScan->setActiveScan(true);
+  pBLEScan->start(30);
+}
+
+
+void loop() {
+  if (doBenchmark) {
+    doBenchmark = false;
+    BLEClient* pClient = BLEDevice::createClient();
+    for (size_t i = 0; i < sizeof(mtuSizes) / sizeof(mtuSizes[0]); i++) {
+      runBenchmark(pClient, mtuSizes[i]);
+    }
+    Serial.println("Benchmark complete.");
+  }
+  delay(1000);
+}
@@ -0,0 +1,211 @@
+/*
+   Server side of the BLE throughput benchmark.  Run BLE_benchmark_client on a second ESP32.
+
+   The benchmark service advertises itself as: 6e7a0001-8c4e-4d59-9f9b-1b4a5f7c0e01
+   and has the following characteristics:
+
+   * CONTROL (write)       - The client writes a command: op, count (2 bytes, little endian), size (2 bytes, little endian).
+                             op 0x01 sends count notifications of size bytes on DATA_TX.
+                             op 0x02 sends count indications of size bytes on DATA_TX, timing each until it is confirmed.
+                             op 0x03 resets the DATA_RX counters.
+   * DATA_TX (notify, indicate) - The data sent by the server.  Each packet starts with its 32 bit sequence number.
+   * DATA_RX (write, write without response) - The data sent by the client, counted by the server.
+   * RESULT (read)         - The server's measurements as text: the bytes and time of the data received on DATA_RX
+                             and the percentiles of the indication latencies of the last indicate run.
+
+   The tests are run from loop() and not from the write callback, since a callback runs on the BLE task and
+   an indication cannot be confirmed while that task is busy.
+*/
+#include <BLEDevice.h>
+#include <BLEServer.h>
+#include <BLEUtils.h>
+#include <BLE2902.h>
+#include <algorithm>
+#include <vector>
+
+#define SERVICE_UUID  "6e7a0001-8c4e-4d59-9f9b-1b4a5f7c0e01"
+#define CONTROL_UUID  "6e7a0002-8c4e-4d59-9f9b-1b4a5f7c0e01"
+#define DATA_TX_UUID  "6e7a0003-8c4e-4d59-9f9b-1b4a5f7c0e01"
+#define DATA_RX_UUID  "6e7a0004-8c4e-4d59-9f9b-1b4a5f7c0e01"
+#define RESULT_UUID   "6e7a0005-8c4e-4d59-9f9b-1b4a5f7c0e01"
+
+#define OP_NOTIFY     0x01
+#define OP_INDICATE   0x02
+#define OP_RESET_RX   0x03
+
+BLEServer*         pServer   = NULL;
+BLECharacteristic* pDataTx   = NULL;
+BLECharacteristic* pResult   = NULL;
+bool               deviceConnected = false;
+
+volatile uint8_t   pendingOp    = 0;
+volatile uint16_t  pendingCount = 0;
+volatile uint16_t  pendingSize  = 0;
+
+volatile uint32_t  rxBytes   = 0;
+volatile uint32_t  rxPackets = 0;
+volatile uint32_t  rxFirstUs = 0;
+volatile uint32_t  rxLastUs  = 0;
+
+std::vector<uint32_t> indicateLatencies;
+
+
+uint32_t percentile(std::vector<uint32_t>& samples, int pct) {
+  if (samples.empty()) {
+    return 0;
+  }
+  size_t index = (samples.size() * pct) / 100;
+  if (index >= samples.size()) {
+    index = samples.size() - 1;
+  }
+  return samples[index];
+}
+
+
+void updateResult() {
+  std::sort(indicateLatencies.begin(), indicateLatencies.end());
+  char text[160];
+  snprintf(text, sizeof(text),
+    "rx_bytes=%u rx_packets=%u rx_us=%u ind_n=%u ind_p50=%u ind_p90=%u ind_p99=%u ind_max=%u",
+    rxBytes, rxPackets, rxLastUs - rxFirstUs, indicateLatencies.size(),
+    percentile(indicateLatencies, 50), percentile(indicateLatencies, 90), percentile(indicateLatencies, 99),
+    indicateLatencies.empty() ? 0 : indicateLatencies.back());
+  pResult->setValue(text);
+}
+
+
+class ServerCallbacks: public BLEServerCallbacks {
+    void onConnect(BLEServer* pServer) {
+      deviceConnected = true;
+    };
+
+    void onDisconnect(BLEServer* pServer) {
+      deviceConnected = false;
+      pendingOp = 0;
+    }
+};
+
+
+class ControlCallbacks: public BLECharacteristicCallbacks {
+    void onWrite(BLECharacteristic* pCharacteristic) {
+      std::string value = pCharacteristic->getValue();
+      if (value.length() < 5) {
+        return;
+      }
+      pendingCount = (uint8_t)value[1] | ((uint8_t)value[2] << 8);
+      pendingSize  = (uint8_t)value[3] | ((uint8_t)value[4] << 8);
+      pendingOp    = value[0];
+    }
+};
+
+
+// Count the data written by the client.  The raw write sink sees each write without it being copied into the value.
+class RxSink: public BLEWriteSink {
+    void onData(const uint8_t* pData, size_t length, uint16_t connId) {
+      uint32_t now = micros();
+      if (rxPackets == 0) {
+        rxFirstUs = now;
+      }
+      rxLastUs = now;
+      rxBytes += length;
+      rxPackets++;
+    }
+};
+
+
+class ResultCallbacks: public BLECharacteristicCallbacks {
+    void onRead(BLECharacteristic* pCharacteristic) {
+      updateResult();
+    }
+};
+
+
+void runTransmit(bool indicate, uint16_t count, uint16_t size) {
+  size_t maxSize = BLEDevice::getMTU() - 3;
+  if (size > maxSize) {
+    size = maxSize;
+  }
+  if (size < 4) {
+    size = 4;
+  }
+  std::vector<uint8_t> packet(size);
+  for (size_t i = 4; i < size; i++) {
+    packet[i] = (uint8_t)i;
+  }
+  if (indicate) {
+    indicateLatencies.clear();
+    indicateLatencies.reserve(count);
+  }
+
+  Serial.printf("%s: %u packets of %u bytes, MTU %u\n", indicate ? "indicate" : "notify", count, size, BLEDevice::getMTU());
+  uint32_t start = micros();
+  for (uint32_t seq = 0; seq < count && deviceConnected; seq++) {
+    memcpy(packet.data(), &seq, sizeof(seq));
+    pDataTx->setValue(packet.data(), size);
+    if (indicate) {
+      uint32_t sent = micros();
+      pDataTx->indicate();   // Returns when the client has confirmed the indication.
+      indicateLatencies.push_back(micros() - sent);
+    } else {
+      pDataTx->notify();
+    }
+  }
+  uint32_t elapsed = micros() - start;
+  Serial.printf("  sent in %u us: %u bytes/s\n", elapsed, elapsed == 0 ? 0 : (uint32_t)((uint64_t)count * size * 1000000 / elapsed));
+  updateResult();
+}
+
+
+void setup() {
+  Serial.begin(115200);
+
+  BLEDevice::init("BLE-Benchmark");
+  BLEDevice::setMTU(517);   // Let the client choose any MTU.
+
+  pServer = BLEDevice::createServer();
+  pServer->setCallbacks(new ServerCallbacks());
+
+  BLEService *pService = pServer->createService(SERVICE_UUID);
+
+  BLECharacteristic* pControl = pService->createCharacteristic(CONTROL_UUID, BLECharacteristic::PROPERTY_WRITE);
+  pControl->setCallbacks(new ControlCallbacks());
+
+  pDataTx = pService->createCharacteristic(DATA_TX_UUID,
+              BLECharacteristic::PROPERTY_NOTIFY | BLECharacteristic::PROPERTY_INDICATE);
+  pDataTx->addDescriptor(new BLE2902());
+
+  BLECharacteristic* pDataRx = pService->createCharacteristic(DATA_RX_UUID,
+              BLECharacteristic::PROPERTY_WRITE | BLECharacteristic::PROPERTY_WRITE_NR);
+  pDataRx->setWriteSink(new RxSink());
+
+  pResult = pService->createCharacteristic(RESULT_UUID, BLECharacteristic::PROPERTY_READ);
+  pResult->setCallbacks(new ResultCallbacks());
+
+  pService->start();
+  pServer->getAdvertising()->addServiceUUID(BLEUUID(SERVICE_UUID));
+  pServer->getAdvertising()->start();
+  Serial.println("Waiting for the benchmark client...");
+}
+
+
+void loop() {
+  uint8_t op = pendingOp;
+  if (op != 0) {
+    pendingOp = 0;
+    switch (op) {
+      case OP_NOTIFY:
+        runTransmit(false, pendingCount, pendingSize);
+        break;
+      case OP_INDICATE:
+        runTransmit(true, pendingCount, pendingSize);
+        break;
+      case OP_RESET_RX:
+        rxBytes   = 0;
+        rxPackets = 0;
+        rxFirstUs = 0;
+        rxLastUs  = 0;
+        break;
+    }
+  }
+  delay(1);
+}
@@ -0,0 +1,96 @@
+/*
+ * BLECallbackExecutor.cpp
+ *
+ *  Created on: Oct 19, 2026
+ */
+#include "sdkconfig.h"
+#if defined(CONFIG_BT_ENABLED)
+#include <esp_log.h>
+#include "BLECallbackExecutor.h"
+#ifdef ARDUINO_ARCH_ESP32
+#include "esp32-hal-log.h"
+#endif
+
+static const char* LOG_TAG = "BLECallbackExecutor";
+
+
+/**
+ * @brief Create an executor and start its worker task.
+ * @param [in] queueLength The number of callbacks that may be waiting to run.
+ * @param [in] stackSize The stack size of the worker task.
+ * @param [in] priority The priority of the worker task.
+ */
+BLECallbackExecutor::BLECallbackExecutor(uint8_t queueLength, uint32_t stackSize, UBaseType_t priority) {
+	m_overflowCount = 0;
+	m_task          = nullptr;
+	m_queue         = ::xQueueCreate(queueLength, sizeof(Job));
+	if (m_queue == nullptr) {
+		ESP_LOGE(LOG_TAG, "Unable to create a queue of %d callbacks", queueLength);
+		return;
+	}
+	if (::xTaskCreate(workerTask, "BLECallbacks", stackSize, this, priority, &m_task) != pdPASS) {
+		ESP_LOGE(LOG_TAG, "Unable to start the worker task");
+		m_task = nullptr;
+	}
+} // BLECallbackExecutor
+
+
+BLECallbackExecutor::~BLECallbackExecutor() {
+	if (m_task != nullptr) {
+		::vTaskDelete(m_task);
+	}
+	if (m_queue != nullptr) {
+		::vQueueDelete(m_queue);
+	}
+} // ~BLECallbackExecutor
+
+
+/**
+ * @brief Get the number of callbacks that were run in place because the queue was full.
+ * @return The number of overflows.
+ */
+uint32_t BLECallbackExecutor::getOverflowCount() {
+	return m_overflowCount;
+} // getOverflowCount
+
+
+/**
+ * @brief Post a callback to the worker task.
+ * This never blocks.
+ * @param [in] function The function to run on the worker task.
+ * @param [in] pObject The object passed to the function.
+ * @param [in] param The event parameters, copied into the job.
+ * @return True if the callback was queued, false if the caller must run it itself.
+ */
+bool BLECallbackExecutor::post(Function function, void* pObject, esp_ble_gatts_cb_param_t* param) {
+	if (m_task == nullptr) {
+		return false;
+	}
+	Job job;
+	job.function = function;
+	job.pObject  = pObject;
+	job.param    = *param;
+	if (::xQueueSend(m_queue, &job, 0) != pdTRUE) {
+		m_overflowCount++;
+		ESP_LOGW(LOG_TAG, "Callback queue full, running the callback in place");
+		return false;
+	}
+	return true;
+} // post
+
+
+/**
+ * @brief The worker task, running the posted callbacks in order.
+ * @param [in] pParam The executor.
+ */
+void BLECallbackExecutor::workerTask(void* pParam) {
+	BLECallbackExecutor* pExecutor = (BLECallbackExecutor*)pParam;
+	Job job;
+	while (true) {
+		if (::xQueueReceive(pExecutor->m_queue, &job, portMAX_DELAY) == pdTRUE) {
+			job.function(job.pObject, &job.param);
+		}
+	}
+} // workerTask
+
+#endif /* CONFIG_BT_ENABLED */
@@ -0,0 +1,52 @@
+/*
+ * BLECallbackExecutor.h
+ *
+ *  Created on: Oct 19, 2026
+ */
+
+#ifndef COMPONENTS_CPP_UTILS_BLECALLBACKEXECUTOR_H_
+#define COMPONENTS_CPP_UTILS_BLECALLBACKEXECUTOR_H_
+#include "sdkconfig.h"
+#if defined(CONFIG_BT_ENABLED)
+#include <esp_gatts_api.h>
+#include "FreeRTOS.h"
+#include <freertos/queue.h>
+
+/**
+ * @brief A worker task that runs application callbacks away from the %BLE task.
+ *
+ * Callbacks are normally invoked on the Bluedroid task, so a callback that does slow work (writing to flash,
+ * publishing over Wi-Fi) holds up all %BLE traffic.  A characteristic or server given an executor posts its
+ * callbacks to the bounded queue of the executor instead, and they run in order on the worker task.  When the
+ * queue is full the callback is run in place, as if there were no executor, and the overflow is counted.
+ * One executor may be shared by several characteristics and servers.
+ */
+class BLECallbackExecutor {
+public:
+	typedef void (*Function)(void* pObject, esp_ble_gatts_cb_param_t* param);
+
+	BLECallbackExecutor(uint8_t queueLength = 8, uint32_t stackSize = 4096, UBaseType_t priority = 5);
+	~BLECallbackExecutor();
+
+	uint32_t getOverflowCount();
+	bool     post(Function function, void* pObject, esp_ble_gatts_cb_param_t* param);
+
+private:
+	struct Job {
+		Function                 function;
+		void*                    pObject;
+		esp_ble_gatts_cb_param_t param;   // A copy; pointers in the event (such as write.value) are not valid in the job.
+	};
+
+	BLECallbackExecutor(const BLECallbackExecutor&) = delete;
+	BLECallbackExecutor& operator=(const BLECallbackExecutor&) = delete;
+
+	static void workerTask(void* pParam);
+
+	QueueHandle_t m_queue;
+	TaskHandle_t  m_task;
+	uint32_t      m_overflowCount;
+}; // BLECallbackExecutor
+
+#endif /* CONFIG_BT_ENABLED */
+#endif /* COMPONENTS_CPP_UTILS_BLECALLBACKEXECUTOR_H_ */
@@ -9,6 +9,7 @@
 #include <sstream>
 #include <string.h>
 #include <iomanip>
+#include <algorithm>
 #include <stdlib.h>
 #include "sdkconfig.h"
 #include <esp_log.h>
@@ -18,6 +19,7 @@
 #include "BLEDevice.h"
 #include "BLEUtils.h"
 #include "BLE2902.h"
+#include "BLECallbackExecutor.h"
 #include "GeneralUtils.h"
 #ifdef ARDUINO_ARCH_ESP32
 #include "esp32-hal-log.h"
@@ -46,6 +48,23 @@ BLECharacteristic::BLECharacteristic(BLEUUID uuid, uint32_t properties) {
 	m_handle     = NULL_HANDLE;
 	m_properties = (esp_gatt_char_prop_t)0;
 	m_pCallbacks = nullptr;
+	m_pWriteSink = nullptr;
+	m_pExecutor  = nullptr;
+	m_pService   = nullptr;
+
+	m_readCacheTtlMs  = 0;
+	m_readCacheValid  = false;
+	m_readCacheTime   = 0;
+	m_readCacheHits   = 0;
+	m_readCacheMisses = 0;
+
+	m_readConnId      = 0;
+	m_readTransId     = 0;
+	m_readDeferred    = false;
+
+	m_coalesceMode    = COALESCE_NONE;
+	m_coalescePending = false;
+	m_coalesceTimer   = nullptr;
 
 	setBroadcastProperty((properties & PROPERTY_BROADCAST) !=0);
 	setReadProperty((properties & PROPERTY_READ) !=0);
@@ -60,6 +79,9 @@ BLECharacteristic::BLECharacteristic(BLEUUID uuid, uint32_t properties) {
  */
 BLECharacteristic::~BLECharacteristic() {
 	//free(m_value.attr_value); // Release the storage for the value.
+	if (m_coalesceTimer != nullptr) {
+		::xTimerDelete(m_coalesceTimer, portMAX_DELAY);
+	}
 } // ~BLECharacteristic
 
 
@@ -96,7 +118,7 @@ void BLECharacteristic::executeCreate(BLEService* pService) {
 	esp_attr_control_t control;
 	control.auto_rsp = ESP_GATT_RSP_BY_APP;
 
-	m_semaphoreCreateEvt.take("executeCreate");
+	BLEServer::takeEventSemaphore(m_pService->getServer(), m_semaphoreCreateEvt, ESP_GATTS_ADD_CHAR_EVT, "executeCreate");
 
 	/*
 	esp_attr_value_t value;
@@ -119,7 +141,7 @@ void BLECharacteristic::executeCreate(BLEService* pService) {
 		return;
 	}
 
-	m_semaphoreCreateEvt.wait("executeCreate");
+	BLEServer::eventSemaphore(m_pService->getServer(), m_semaphoreCreateEvt).wait("executeCreate");
 
 	// Now that we have registered the characteristic, we must also register all the descriptors associated with this
 	// characteristic.  We iterate through each of those and invoke the registration call to register them with the
@@ -181,6 +203,210 @@ BLEService* BLECharacteristic::getService() {
 } // getService
 
 
+/**
+ * @brief Get the number of reads served from the read cache.
+ * @return The number of reads for which onRead() was skipped.
+ */
+uint32_t BLECharacteristic::getReadCacheHits() {
+	return m_readCacheHits;
+} // getReadCacheHits
+
+
+/**
+ * @brief Get the number of reads that refreshed the read cache.
+ * @return The number of reads for which onRead() was invoked while the read cache is enabled.
+ */
+uint32_t BLECharacteristic::getReadCacheMisses() {
+	return m_readCacheMisses;
+} // getReadCacheMisses
+
+
+/**
+ * @brief Respond to a read from the current value.
+ * A value that does not fit in one response is copied once into a snapshot for the follow on requests of the
+ * connection; a value that fits is sent straight from the characteristic with no snapshot.
+ * @param [in] gatts_if The GATT server interface.
+ * @param [in] connId The connection that asked.
+ * @param [in] transId The transaction of the read.
+ */
+void BLECharacteristic::sendReadResponse(esp_gatt_if_t gatts_if, uint16_t connId, uint32_t transId) {
+	uint16_t maxOffset = BLEDevice::getMTU() - 1;
+	if (BLEDevice::getMTU() > 512) {
+		maxOffset = 512;
+	}
+	esp_gatt_rsp_t rsp;
+	size_t length = m_value.getLength();
+
+	if (length+1 > maxOffset) {
+		// Too big for a single shot entry.  Freeze the value for the follow on requests; this is the one
+		// copy of the value made for a long read.
+		getService()->getServer()->m_semaphoreReadState.take("sendReadResponse");
+		m_readSnapshots[connId].assign((const char*)m_value.getData(), length);
+		getService()->getServer()->m_semaphoreReadState.give();
+		rsp.attr_value.len    = maxOffset;
+		rsp.attr_value.offset = 0;
+		memcpy(rsp.attr_value.value, m_value.getData(), rsp.attr_value.len);
+	} else {
+		// Will fit in a single packet with no callbacks required.  Drop the snapshot of a long read the client
+		// abandoned, if there is one.  ATT has one request of a connection outstanding at a time, so no snapshot
+		// for connId can be being added while this runs.
+		if (!m_readSnapshots.empty()) {
+			getService()->getServer()->m_semaphoreReadState.take("sendReadResponse");
+			m_readSnapshots.erase(connId);
+			getService()->getServer()->m_semaphoreReadState.give();
+		}
+		rsp.attr_value.len    = length;
+		rsp.attr_value.offset = 0;
+		memcpy(rsp.attr_value.value, m_value.getData(), rsp.attr_value.len);
+	}
+	rsp.attr_value.handle   = m_handle;
+	rsp.attr_value.auth_req = ESP_GATT_AUTH_REQ_NONE;
+
+	char *pHexData = BLEUtils::buildHexData(nullptr, rsp.attr_value.value, rsp.attr_value.len);
+	ESP_LOGD(LOG_TAG, " - Data: length=%d, data=%s, offset=%d", rsp.attr_value.len, pHexData, rsp.attr_value.offset);
+	free(pHexData);
+
+	esp_err_t errRc = ::esp_ble_gatts_send_response(gatts_if, connId, transId, ESP_GATT_OK, &rsp);
+	if (errRc != ESP_OK) {
+		ESP_LOGE(LOG_TAG, "esp_ble_gatts_send_response: rc=%d %s", errRc, GeneralUtils::errorToString(errRc));
+	}
+} // sendReadResponse
+
+
+/**
+ * @brief Complete a read that onRead() deferred with deferReadResponse().
+ * The response carries the value of the characteristic as it is now.  This may be called from any task.
+ * @param [in] connId The connection returned by deferReadResponse().
+ */
+void BLECharacteristic::sendReadResponse(uint16_t connId) {
+	getService()->getServer()->m_semaphoreReadState.take("sendReadResponse");
+	auto it = m_deferredReads.find(connId);
+	if (it == m_deferredReads.end()) {
+		getService()->getServer()->m_semaphoreReadState.give();
+		ESP_LOGE(LOG_TAG, "No deferred read for connId=%d", connId);
+		return;
+	}
+	uint32_t transId = it->second;
+	m_deferredReads.erase(it);
+	getService()->getServer()->m_semaphoreReadState.give();
+	sendReadResponse(getService()->getServer()->getGattsIf(), connId, transId);
+	markReadCacheFresh();
+} // sendReadResponse
+
+
+/**
+ * @brief Hold back the response to the read being handled by onRead().
+ *
+ * Call this from onRead() when the value is not ready yet, for example because it has to be fetched.  The
+ * %BLE task is then released straight away and the read is completed later by calling sendReadResponse() with
+ * the returned connection id, once the value has been set.  The client must get its response within the ATT
+ * transaction timeout of 30 seconds.
+ * @return The connection id to pass to sendReadResponse().
+ */
+uint16_t BLECharacteristic::deferReadResponse() {
+	// Only called from within onRead(), while invokeOnRead() holds the OnRead lock of the server.
+	getService()->getServer()->m_semaphoreReadState.take("deferReadResponse");
+	m_deferredReads[m_readConnId] = m_readTransId;
+	getService()->getServer()->m_semaphoreReadState.give();
+	m_readDeferred = true;
+	return m_readConnId;
+} // deferReadResponse
+
+
+/**
+ * @brief Invoke onRead() for a read.
+ * onRead() is invoked by one task at a time: the read it handles is recorded in members for deferReadResponse(),
+ * and the executor worker and the %BLE task (when the executor queue is full) may otherwise both be in onRead().
+ * @param [in] connId The connection that asked.
+ * @param [in] transId The transaction of the read.
+ * @return True if onRead() deferred the response with deferReadResponse().
+ */
+bool BLECharacteristic::invokeOnRead(uint16_t connId, uint32_t transId) {
+	getService()->getServer()->m_semaphoreOnRead.take("invokeOnRead");
+	m_readConnId   = connId;
+	m_readTransId  = transId;
+	m_readDeferred = false;
+	m_pCallbacks->onRead(this);
+	bool deferred = m_readDeferred;
+	getService()->getServer()->m_semaphoreOnRead.give();
+	return deferred;
+} // invokeOnRead
+
+
+/**
+ * @brief Start the lifetime of the read cache, once onRead() has produced the value.
+ * Called after onRead() has returned, or after a deferred read has been answered, so that no read is served
+ * from the cache while onRead() is still producing the value.
+ */
+void BLECharacteristic::markReadCacheFresh() {
+	if (m_readCacheTtlMs != 0) {
+		m_readCacheTime  = FreeRTOS::getTimeSinceStart();
+		m_readCacheValid = true;
+	}
+} // markReadCacheFresh
+
+
+/**
+ * @brief Invoke onWrite(), if there are callbacks.
+ */
+void BLECharacteristic::invokeOnWrite() {
+	if (m_pCallbacks != nullptr) {
+		m_pCallbacks->onWrite(this); // Invoke the onWrite callback handler.
+	}
+} // invokeOnWrite
+
+
+/**
+ * @brief Run onRead() for a read on the worker task of the executor and respond to the read.
+ * @param [in] pObject The characteristic.
+ * @param [in] param A copy of the read event.
+ */
+void BLECharacteristic::deferredRead(void* pObject, esp_ble_gatts_cb_param_t* param) {
+	BLECharacteristic* pCharacteristic = (BLECharacteristic*)pObject;
+	if (!pCharacteristic->invokeOnRead(param->read.conn_id, param->read.trans_id)) {
+		pCharacteristic->sendReadResponse(pCharacteristic->getService()->getServer()->getGattsIf(),
+			param->read.conn_id, param->read.trans_id);
+		pCharacteristic->markReadCacheFresh();
+	}
+} // deferredRead
+
+
+/**
+ * @brief Run onWrite() on the worker task of the executor.
+ * @param [in] pObject The characteristic.
+ * @param [in] param A copy of the write event.
+ */
+void BLECharacteristic::deferredWrite(void* pObject, esp_ble_gatts_cb_param_t* param) {
+	((BLECharacteristic*)pObject)->invokeOnWrite();
+} // deferredWrite
+
+
+/**
+ * @brief Run the callbacks of the characteristic on the worker task of an executor.
+ *
+ * onRead() and onWrite() then no longer hold up the %BLE task.  The response to a read is sent once onRead()
+ * has run on the worker.  onWrite() runs after the response to the write has been sent, and sees the value of
+ * the characteristic at that time, which a later write may already have replaced.
+ * @param [in] pExecutor The executor, or nullptr to invoke the callbacks on the %BLE task (the default).
+ */
+void BLECharacteristic::setCallbackExecutor(BLECallbackExecutor* pExecutor) {
+	m_pExecutor = pExecutor;
+} // setCallbackExecutor
+
+
+/**
+ * @brief Get the RAM used by the characteristic.
+ * The descriptors of the characteristic are not included, see BLEDescriptor::getMemoryUsage().
+ * @return The size of the characteristic object plus the heap it owns.
+ */
+size_t BLECharacteristic::getMemoryUsage() {
+	size_t size = sizeof(BLECharacteristic) + m_value.getHeapSize() + m_descriptorMap.getMemoryUsage();
+	size += m_semaphoreCreateEvt.getHeapSize() + m_semaphoreConfEvt.getHeapSize() + m_semaphoreCoalesce.getHeapSize();
+	size += m_coalesceBuffer.capacity();
+	return size;
+} // getMemoryUsage
+
+
 /**
  * @brief Get the UUID of the characteristic.
  * @return The UUID of the characteristic.
@@ -198,6 +424,14 @@ std::string BLECharacteristic::getValue() {
 	return m_value.getValue();
 } // getValue
 
+/**
+ * @brief Retrieve a view of the current value of the characteristic without copying it.
+ * @return A span over the current value.  It is only valid until the value is next changed.
+ */
+BLESpan BLECharacteristic::getValueSpan() {
+	return m_value.getSpan();
+} // getValueSpan
+
 /**
  * @brief Retrieve the current raw data of the characteristic.
  * @return A pointer to storage containing the current characteristic data.
@@ -246,23 +480,14 @@ void BLECharacteristic::handleGATTServerEvent(
 		// - uint8_t exec_write_flag - Either ESP_GATT_PREP_WRITE_EXEC or ESP_GATT_PREP_WRITE_CANCEL
 		//
 		case ESP_GATTS_EXEC_WRITE_EVT: {
-			if(m_writeEvt){
-				m_writeEvt = false;
+			// The response to the execute write is sent by the server once every characteristic has seen the event.
+			BLEPrepareWritePool* pPool = &getService()->getServer()->m_prepareWritePool;
+			if (pPool->isPending(param->exec_write.conn_id, m_handle)) {
 				if (param->exec_write.exec_write_flag == ESP_GATT_PREP_WRITE_EXEC) {
-					m_value.commit();
-					if (m_pCallbacks != nullptr) {
-						m_pCallbacks->onWrite(this); // Invoke the onWrite callback handler.
-					}
+					pPool->commit(param->exec_write.conn_id, m_handle, &m_value);
+					invokeOnWrite();
 				} else {
-					m_value.cancel();
-				}
-
-				esp_err_t errRc = ::esp_ble_gatts_send_response(
-						gatts_if,
-						param->write.conn_id,
-						param->write.trans_id, ESP_GATT_OK, nullptr);
-				if (errRc != ESP_OK) {
-					ESP_LOGE(LOG_TAG, "esp_ble_gatts_send_response: rc=%d %s", errRc, GeneralUtils::errorToString(errRc));
+					pPool->cancel(param->exec_write.conn_id, m_handle);
 				}
 			}
 			break;
@@ -279,7 +504,7 @@ void BLECharacteristic::handleGATTServerEvent(
 			if (getUUID().equals(BLEUUID(param->add_char.char_uuid)) &&
 					getHandle() == param->add_char.attr_handle &&
 					getService()->getHandle()==param->add_char.service_handle) {
-				m_semaphoreCreateEvt.give();
+				BLEServer::giveEventSemaphore(m_pService->getServer(), m_semaphoreCreateEvt, ESP_GATTS_ADD_CHAR_EVT);
 			}
 			break;
 		} // ESP_GATTS_ADD_CHAR_EVT
@@ -303,13 +528,16 @@ void BLECharacteristic::handleGATTServerEvent(
 // we save the new value.  Next we look at the need_rsp flag which indicates whether or not we need
 // to send a response.  If we do, then we formulate a response and send it.
 			if (param->write.handle == m_handle) {
+				esp_gatt_status_t status = ESP_GATT_OK;
 				if (param->write.is_prep) {
-					m_value.addPart(param->write.value, param->write.len);
-					m_writeEvt = true;
+					status = getService()->getServer()->m_prepareWritePool.write(
+						param->write.conn_id, m_handle, param->write.offset, param->write.value, param->write.len);
 				} else {
 					setValue(param->write.value, param->write.len);
-					if (m_pCallbacks != nullptr && param->write.is_prep != true) {
-						m_pCallbacks->onWrite(this); // Invoke the onWrite callback handler.
+					if (m_pCallbacks != nullptr) {
+						if (m_pExecutor == nullptr || !m_pExecutor->post(deferredWrite, this, param)) {
+							invokeOnWrite();
+						}
 					}
 				}
 
@@ -332,7 +560,7 @@ void BLECharacteristic::handleGATTServerEvent(
 					esp_err_t errRc = ::esp_ble_gatts_send_response(
 							gatts_if,
 							param->write.conn_id,
-							param->write.trans_id, ESP_GATT_OK, &rsp);
+							param->write.trans_id, status, &rsp);
 					if (errRc != ESP_OK) {
 						ESP_LOGE(LOG_TAG, "esp_ble_gatts_send_response: rc=%d %s", errRc, GeneralUtils::errorToString(errRc));
 					}
@@ -358,7 +586,6 @@ void BLECharacteristic::handleGATTServerEvent(
 			if (param->read.handle == m_handle) {
 
 
-
 // Here's an interesting thing.  The read request has the option of saying whether we need a response
 // or not.  What would it "mean" to receive a read request and NOT send a response back?  That feels like
 // a very strange read.
@@ -372,8 +599,11 @@ void BLECharacteristic::handleGATTServerEvent(
 // 22 bytes, then we "just" send it and thats the end of the story.
 // If we are sending 22 bytes exactly, we just send it BUT we will get a follow on request.
 // If we are sending more than 22 bytes, we send the first 22 bytes and we will get a follow on request.
-// Because of follow on request processing, we need to maintain an offset of how much data we have already sent
-// so that when a follow on request arrives, we know where to start in the data to send the next sequence.
+// Because of follow on request processing, the value being read must not change between the first request and
+// the follow on requests.  When a read will not fit in a single response, we freeze a snapshot of the value for the
+// connection that asked and serve the follow on requests from that snapshot at the offset the client supplies.
+// The snapshot belongs to the connection so that long reads of the same characteristic by two clients can be
+// interleaved.  It is released when we send the last piece or when the client disconnects.
 // Note that the indication that the client will send a follow on request is that we sent exactly 22 bytes as a response.
 // If our payload is divisible by 22 then the last response will be a response of 0 bytes in length.
 //
@@ -390,41 +620,68 @@ void BLECharacteristic::handleGATTServerEvent(
 					esp_gatt_rsp_t rsp;
 
 					if (param->read.is_long) {
-						std::string value = m_value.getValue();
+						getService()->getServer()->m_semaphoreReadState.take("read");
+						auto it = m_readSnapshots.find(param->read.conn_id);
+						if (it == m_readSnapshots.end()) {
+							// A follow on request without a first request; freeze the value as it is now.
+							it = m_readSnapshots.insert(std::pair<uint16_t, std::string>(param->read.conn_id, std::string())).first;
+							it->second.assign((const char*)m_value.getData(), m_value.getLength());
+						}
+						const std::string& snapshot = it->second;
+
+						if (param->read.offset > snapshot.length()) {
+							ESP_LOGE(LOG_TAG, "Read offset %d beyond value length %d", param->read.offset, snapshot.length());
+							m_readSnapshots.erase(it);
+							getService()->getServer()->m_semaphoreReadState.give();
+							esp_err_t errRc = ::esp_ble_gatts_send_response(
+									gatts_if, param->read.conn_id,
+									param->read.trans_id,
+									ESP_GATT_INVALID_OFFSET,
+									nullptr);
+							if (errRc != ESP_OK) {
+								ESP_LOGE(LOG_TAG, "esp_ble_gatts_send_response: rc=%d %s", errRc, GeneralUtils::errorToString(errRc));
+							}
+							break;
+						}
 
-						if (value.length() - m_value.getReadOffset() < maxOffset) {
+						rsp.attr_value.offset = param->read.offset;
+						if (snapshot.length() - param->read.offset < maxOffset) {
 							// This is the last in the chain
-							rsp.attr_value.len    = value.length() - m_value.getReadOffset();
-							rsp.attr_value.offset = m_value.getReadOffset();
-							memcpy(rsp.attr_value.value, value.data() + rsp.attr_value.offset, rsp.attr_value.len);
-							m_value.setReadOffset(0);
+							rsp.attr_value.len = snapshot.length() - param->read.offset;
+							memcpy(rsp.attr_value.value, snapshot.data() + rsp.attr_value.offset, rsp.attr_value.len);
+							m_readSnapshots.erase(it);
 						} else {
 							// There will be more to come.
-							rsp.attr_value.len    = maxOffset;
-							rsp.attr_value.offset = m_value.getReadOffset();
-							memcpy(rsp.attr_value.value, value.data() + rsp.attr_value.offset, rsp.attr_value.len);
-							m_value.setReadOffset(rsp.attr_value.offset + maxOffset);
+							rsp.attr_value.len = maxOffset;
+							memcpy(rsp.attr_value.value, snapshot.data() + rsp.attr_value.offset, rsp.attr_value.len);
 						}
+						getService()->getServer()->m_semaphoreReadState.give();
 					} else { // read.is_long == false
 
 						if (m_pCallbacks != nullptr) {  // If is.long is false then this is the first (or only) request to read data, so invoke the callback
-							m_pCallbacks->onRead(this);   // Invoke the read callback.
+							// unless the value it produced last time is still fresh.
+							uint32_t now = FreeRTOS::getTimeSinceStart();
+							if (m_readCacheTtlMs != 0 && m_readCacheValid &&
+									(m_readCacheTtlMs == READ_CACHE_FOREVER || now - m_readCacheTime < m_readCacheTtlMs)) {
+								m_readCacheHits++;
+							} else {
+								if (m_readCacheTtlMs != 0) {
+									m_readCacheMisses++;
+								}
+								// With an executor the worker task invokes onRead() and then responds.
+								if (m_pExecutor != nullptr && m_pExecutor->post(deferredRead, this, param)) {
+									break;
+								}
+								// Invoke the read callback.
+								if (invokeOnRead(param->read.conn_id, param->read.trans_id)) {
+									break;   // The application responds later with sendReadResponse().
+								}
+								markReadCacheFresh();   // Only now does the value hold what onRead() produced.
+							}
 						}
 
-						std::string value = m_value.getValue();
-
-						if (value.length()+1 > maxOffset) {
-							// Too big for a single shot entry.
-							m_value.setReadOffset(maxOffset);
-							rsp.attr_value.len    = maxOffset;
-							rsp.attr_value.offset = 0;
-							memcpy(rsp.attr_value.value, value.data(), rsp.attr_value.len);
-						} else {
-							// Will fit in a single packet with no callbacks required.
-							rsp.attr_value.len    = value.length();
-							rsp.attr_value.offset = 0;
-							memcpy(rsp.attr_value.value, value.data(), rsp.attr_value.len);
-						}
+						sendReadResponse(gatts_if, param->read.conn_id, param->read.trans_id);
+						break;
 					}
 					rsp.attr_value.handle   = param->read.handle;
 					rsp.attr_value.auth_req = ESP_GATT_AUTH_REQ_NONE;
@@ -464,6 +721,11 @@ void BLECharacteristic::handleGATTServerEvent(
 		}
 
 		case ESP_GATTS_DISCONNECT_EVT: {
+			if (!m_readSnapshots.empty()) {
+				getService()->getServer()->m_semaphoreReadState.take("disconnect");
+				m_readSnapshots.erase(param->disconnect.conn_id); // Abandon any long read in progress for this client.
+				getService()->getServer()->m_semaphoreReadState.give();
+			}
 			m_semaphoreConfEvt.give();
 			break;
 		}
@@ -490,12 +752,13 @@ void BLECharacteristic::handleGATTServerEvent(
  */
 void BLECharacteristic::indicate() {
 
-	ESP_LOGD(LOG_TAG, ">> indicate: length: %d", m_value.getValue().length());
+	size_t length = m_value.getLength();
+	ESP_LOGD(LOG_TAG, ">> indicate: length: %d", length);
 
 	assert(getService() != nullptr);
 	assert(getService()->getServer() != nullptr);
 
-	GeneralUtils::hexDump((uint8_t*)m_value.getValue().data(), m_value.getValue().length());
+	GeneralUtils::hexDump(m_value.getData(), length);
 
 	if (getService()->getServer()->getConnectedCount() == 0) {
 		ESP_LOGD(LOG_TAG, "<< indicate: No connected clients.");
@@ -511,44 +774,176 @@ void BLECharacteristic::indicate() {
 		return;
 	}
 
-	if (m_value.getValue().length() > (BLEDevice::getMTU() - 3)) {
+	if (length > (BLEDevice::getMTU() - 3)) {
 		ESP_LOGI(LOG_TAG, "- Truncating to %d bytes (maximum indicate size)", BLEDevice::getMTU() - 3);
 	}
 
-	size_t length = m_value.getValue().length();
-
 	m_semaphoreConfEvt.take("indicate");
 
 	esp_err_t errRc = ::esp_ble_gatts_send_indicate(
 			getService()->getServer()->getGattsIf(),
 			getService()->getServer()->getConnId(),
-			getHandle(), length, (uint8_t*)m_value.getValue().data(), true); // The need_confirm = true makes this an indication.
+			getHandle(), length, m_value.getData(), true); // The need_confirm = true makes this an indication.
 
 	if (errRc != ESP_OK) {
 		ESP_LOGE(LOG_TAG, "<< esp_ble_gatts_send_indicate: rc=%d %s", errRc, GeneralUtils::errorToString(errRc));
 		return;
 	}
+	getService()->getServer()->noteTraffic(getService()->getServer()->getConnId(), length);
 
 	m_semaphoreConfEvt.wait("indicate");
 	ESP_LOGD(LOG_TAG, "<< indicate");
 } // indicate
 
 
+/**
+ * @brief Queue an indication of the current value to the most recently connected client.
+ * @return True if the indication was queued.
+ */
+bool BLECharacteristic::indicateAsync() {
+	return indicateAsync(getService()->getServer()->getConnId());
+} // indicateAsync
+
+
+/**
+ * @brief Queue an indication of the current value without waiting for its confirmation.
+ * The value is captured now.  Indications queued on a connection are sent one after the other as the
+ * client confirms them, and the outcome of each is reported through BLECharacteristicCallbacks::onStatus().
+ * The number of queued indications and the confirmation timeout are set with BLEServer::setIndicationLimits().
+ * @param [in] connId The connection on which to indicate.
+ * @return True if the indication was queued, false if it could not be (the reason is also reported to onStatus()).
+ */
+bool BLECharacteristic::indicateAsync(uint16_t connId) {
+	ESP_LOGD(LOG_TAG, ">> indicateAsync: connId=%d, length: %d", connId, m_value.getLength());
+	assert(getService() != nullptr);
+	assert(getService()->getServer() != nullptr);
+
+	BLECharacteristicCallbacks::Status status = BLECharacteristicCallbacks::ERROR_GATT;
+	if (getService()->getServer()->getConnectedCount() == 0) {
+		status = BLECharacteristicCallbacks::ERROR_NO_CLIENT;
+	} else {
+		BLE2902 *p2902 = (BLE2902*)getDescriptorByUUID((uint16_t)0x2902);
+		if (p2902 != nullptr && !p2902->getIndications()) {
+			status = BLECharacteristicCallbacks::ERROR_INDICATE_DISABLED;
+		} else {
+			size_t length = std::min(m_value.getLength(), (size_t)(getService()->getServer()->getPeerMTU(connId) - 3));
+			uint8_t refused;
+			if (getService()->getServer()->m_indicationQueue.enqueue(this, connId, m_value.getData(), length, &refused)) {
+				getService()->getServer()->noteTraffic(connId, length);
+				ESP_LOGD(LOG_TAG, "<< indicateAsync");
+				return true;
+			}
+			status = (BLECharacteristicCallbacks::Status)refused;
+			if (status == BLECharacteristicCallbacks::ERROR_QUEUE_FULL && getService()->getServer()->m_pConnParamsPolicy != nullptr) {
+				getService()->getServer()->m_pConnParamsPolicy->onBacklog(connId);
+			}
+		}
+	}
+	ESP_LOGD(LOG_TAG, "<< indicateAsync: not sent (%d)", status);
+	if (m_pCallbacks != nullptr) {
+		m_pCallbacks->onStatus(this, status, connId, 0);
+	}
+	return false;
+} // indicateAsync
+
+
 /**
  * @brief Send a notify.
  * A notification is a transmission of up to the first 20 bytes of the characteristic value.  An notification
  * will not block; it is a fire and forget.
+ *
+ * When notification coalescing is enabled (see setNotifyCoalescing()) nothing is sent here; the value is
+ * recorded and sent at the next flush.
  * @return N/A.
  */
 void BLECharacteristic::notify() {
-	ESP_LOGD(LOG_TAG, ">> notify: length: %d", m_value.getValue().length());
+	if (m_coalesceMode == COALESCE_NONE) {
+		sendNotify(m_value.getData(), m_value.getLength());
+		return;
+	}
+
+	if (m_coalesceMode == COALESCE_LATEST) {
+		m_semaphoreCoalesce.take("notify");
+		m_coalescePending = true;
+		m_semaphoreCoalesce.give();
+		return;
+	}
+
+	// COALESCE_APPEND: add the value to the pending packet, sending that packet first if the value would not fit.
+	// The check and the append are made under one lock so that a concurrent notify() or flush cannot come between them.
+	size_t maxLength = notifyPacketSize(getService()->getServer()->getConnId());
+	size_t length    = std::min(m_value.getLength(), (size_t)(BLEDevice::getMTU() - 3));
+	m_semaphoreCoalesce.take("notify");
+	if (!m_coalesceBuffer.empty() && m_coalesceBuffer.length() + length > maxLength) {
+		sendNotify((uint8_t*)m_coalesceBuffer.data(), m_coalesceBuffer.length(), false);
+		m_coalesceBuffer.clear();   // Keeps the capacity for the next packet.
+	}
+	m_coalesceBuffer.append((char*)m_value.getData(), length);
+	m_semaphoreCoalesce.give();
+} // Notify
+
+
+/**
+ * @brief Send the notification held back by notification coalescing, if any.
+ * This is called by the flush timer but may also be called by the application, for example at the end of a burst.
+ * The notification is handed to the stack without waiting for its ESP_GATTS_CONF_EVT, so that the flush never
+ * holds up the %FreeRTOS timer task.
+ * @return N/A.
+ */
+void BLECharacteristic::flushNotify() {
+	m_semaphoreCoalesce.take("flushNotify");
+	if (m_coalesceMode == COALESCE_LATEST) {
+		if (m_coalescePending) {
+			// setValue() takes the same lock, and the stack copies the value before this returns.
+			m_coalescePending = false;
+			sendNotify(m_value.getData(), m_value.getLength(), false);
+		}
+	} else if (m_coalesceMode == COALESCE_APPEND) {
+		if (!m_coalesceBuffer.empty()) {
+			sendNotify((uint8_t*)m_coalesceBuffer.data(), m_coalesceBuffer.length(), false);
+			m_coalesceBuffer.clear();   // Keeps the capacity for the next packet.
+		}
+	}
+	m_semaphoreCoalesce.give();
+} // flushNotify
+
+
+/**
+ * @brief Get the size of a coalesced notification packet on a connection.
+ * A notification that fills a whole number of link layer packets is sent with no part-filled packet at the
+ * end, so the size is the largest such up to MTU-3.  The notification is carried in one L2CAP frame, of the
+ * 4 octet L2CAP header, the 3 octet notification header and the value, split over link layer packets of the
+ * data length (27 octets without Data Length Extension): 101 octets of value fill 4 such packets.
+ * @param [in] connId The connection, whose MTU and data length are used.
+ * @return The number of bytes of value to put in a notification.
+ */
+size_t BLECharacteristic::notifyPacketSize(uint16_t connId) {
+	size_t maxLength  = getService()->getServer()->getPeerMTU(connId) - 3;
+	size_t dataLength = getService()->getServer()->getDataLength(connId);
+	size_t packets    = (maxLength + 3 + 4) / dataLength;
+	if (packets == 0) {
+		return maxLength;
+	}
+	return packets * dataLength - 4 - 3;
+} // notifyPacketSize
+
+
+/**
+ * @brief Send a notification of the given data to the connected client.
+ * @param [in] pData The data to send.  The stack copies it before this returns.
+ * @param [in] length The length of the data.
+ * @param [in] waitConf True to block until the stack reports the notification sent, false to return at once.
+ * @return N/A.
+ */
+void BLECharacteristic::sendNotify(uint8_t* pData, size_t length, bool waitConf) {
+	ESP_LOGD(LOG_TAG, ">> notify: length: %d", length);
 
 
 	assert(getService() != nullptr);
 	assert(getService()->getServer() != nullptr);
 
 
-	GeneralUtils::hexDump((uint8_t*)m_value.getValue().data(), m_value.getValue().length());
+	GeneralUtils::hexDump(pData, length);
 
 	if (getService()->getServer()->getConnectedCount() == 0) {
 		ESP_LOGD(LOG_TAG, "<< notify: No connected clients.");
@@ -564,27 +959,85 @@ void BLECharacteristic::notify() {
 		return;
 	}
 
-	if (m_value.getValue().length() > (BLEDevice::getMTU() - 3)) {
+	if (length > (BLEDevice::getMTU() - 3)) {
 		ESP_LOGI(LOG_TAG, "- Truncating to %d bytes (maximum notify size)", BLEDevice::getMTU() - 3);
 	}
 
-	size_t length = m_value.getValue().length();
-
-	m_semaphoreConfEvt.take("notify");
+	if (waitConf) {
+		m_semaphoreConfEvt.take("notify");
+	}
 
 	esp_err_t errRc = ::esp_ble_gatts_send_indicate(
 			getService()->getServer()->getGattsIf(),
 			getService()->getServer()->getConnId(),
-			getHandle(), length, (uint8_t*)m_value.getValue().data(), false); // The need_confirm = false makes this a notify.
+			getHandle(), length, pData, false); // The need_confirm = false makes this a notify.
 	if (errRc != ESP_OK) {
 		ESP_LOGE(LOG_TAG, "<< esp_ble_gatts_send_indicate: rc=%d %s", errRc, GeneralUtils::errorToString(errRc));
+		if (waitConf) {
+			m_semaphoreConfEvt.give();
+		}
 		return;
 	}
+	getService()->getServer()->noteTraffic(getService()->getServer()->getConnId(), length);
 
-	m_semaphoreConfEvt.wait("notify");
+	if (waitConf) {
+		m_semaphoreConfEvt.wait("notify");
+	}
 
 	ESP_LOGD(LOG_TAG, "<< notify");
-} // Notify
+} // sendNotify
+
+
+/**
+ * @brief Flush timer callback for notification coalescing.
+ * @param [in] timer The timer that expired; its ID is the characteristic.
+ */
+void BLECharacteristic::coalesceTimerCallback(TimerHandle_t timer) {
+	((BLECharacteristic*)::pvTimerGetTimerID(timer))->flushNotify();
+} // coalesceTimerCallback
+
+
+/**
+ * @brief Coalesce the notifications of a fast changing characteristic.
+ *
+ * Values that change faster than the connection can carry them flood the stack (or block the caller)
+ * when each change is notified.  With coalescing, notify() only records the value and the notifications
+ * are sent at most once per flush interval:
+ *
+ * * COALESCE_LATEST - Only the value current at the flush is sent.
+ * * COALESCE_APPEND - Each notified value is appended to a packet of up to MTU-3 bytes, trimmed to fill whole
+ *   link layer packets at the data length negotiated on the connection.  The packet is sent at the flush, or
+ *   earlier when the next value would not fit.
+ *
+ * The flush interval bounds the latency added to a value.  Bluedroid does not report connection events so the
+ * interval would typically be set to the connection interval.  The flush runs on the %FreeRTOS timer task, so
+ * coalesced notifications are handed to the stack without waiting for it to report them sent.  Change the value
+ * with setValue() only: while coalescing it takes the lock that the flush holds while it sends the value.
+ * @param [in] mode One of COALESCE_NONE, COALESCE_LATEST or COALESCE_APPEND.
+ * @param [in] flushIntervalMs The flush interval.  With 0 nothing is flushed automatically and the application calls flushNotify().
+ * @return N/A.
+ */
+void BLECharacteristic::setNotifyCoalescing(uint8_t mode, uint32_t flushIntervalMs) {
+	ESP_LOGD(LOG_TAG, ">> setNotifyCoalescing: mode=%d, interval=%d", mode, flushIntervalMs);
+	if (m_coalesceTimer != nullptr) {
+		::xTimerDelete(m_coalesceTimer, portMAX_DELAY);
+		m_coalesceTimer = nullptr;
+	}
+	flushNotify();   // Don't lose what was held back in the previous mode.
+
+	m_semaphoreCoalesce.take("setNotifyCoalescing");
+	m_coalesceMode = mode;
+	m_semaphoreCoalesce.give();
+	if (mode != COALESCE_NONE && flushIntervalMs > 0) {
+		TickType_t period = flushIntervalMs / portTICK_PERIOD_MS;
+		m_coalesceTimer = ::xTimerCreate("notifyFlush", period > 0 ? period : 1, pdTRUE, this, coalesceTimerCallback);
+		if (m_coalesceTimer == nullptr || ::xTimerStart(m_coalesceTimer, portMAX_DELAY) != pdPASS) {
+			ESP_LOGE(LOG_TAG, "<< setNotifyCoalescing: unable to start the flush timer");
+			return;
+		}
+	}
+	ESP_LOGD(LOG_TAG, "<< setNotifyCoalescing");
+} // setNotifyCoalescing
 
 
 /**
@@ -628,10 +1081,58 @@ void BLECharacteristic::setCallbacks(BLECharacteristicCallbacks* pCallbacks) {
 void BLECharacteristic::setHandle(uint16_t handle) {
 	ESP_LOGD(LOG_TAG, ">> setHandle: handle=0x%.2x, characteristic uuid=%s", handle, getUUID().toString().c_str());
 	m_handle = handle;
+	registerWriteSink();
 	ESP_LOGD(LOG_TAG, "<< setHandle");
 } // setHandle
 
 
+/**
+ * @brief Attach a raw write sink to the characteristic.
+ *
+ * Writes received for the characteristic are then delivered to the sink as (data, length, conn_id)
+ * straight from the %BLE event, see BLEWriteSink.  Prepared (long) writes still go through the
+ * characteristic value.
+ * @param [in] pSink The sink to receive the written data or nullptr to go back to the normal write handling.
+ */
+void BLECharacteristic::setWriteSink(BLEWriteSink* pSink) {
+	if (pSink == nullptr && m_pWriteSink != nullptr && m_pService != nullptr && m_handle != NULL_HANDLE) {
+		m_pService->getServer()->m_writeSinkMap.erase(m_handle);
+	}
+	m_pWriteSink = pSink;
+	registerWriteSink();
+} // setWriteSink
+
+
+/**
+ * @brief Register the characteristic with the server as the target of raw writes.
+ * This can only be done once both the sink and the handle of the characteristic are known.
+ */
+void BLECharacteristic::registerWriteSink() {
+	if (m_pWriteSink != nullptr && m_pService != nullptr && m_handle != NULL_HANDLE) {
+		m_pService->getServer()->m_writeSinkMap[m_handle] = this;
+	}
+} // registerWriteSink
+
+
+/**
+ * @brief Deliver a write event to the attached write sink.
+ * The server calls this in place of the normal event dispatch so that nothing is copied or logged on this path.
+ * @param [in] gatts_if The GATT server interface.
+ * @param [in] param The write event parameters.
+ */
+void BLECharacteristic::handleRawWrite(esp_gatt_if_t gatts_if, esp_ble_gatts_cb_param_t* param) {
+	m_pWriteSink->onData(param->write.value, param->write.len, param->write.conn_id);
+	if (param->write.need_rsp) {
+		// A write response carries no attribute value.
+		esp_err_t errRc = ::esp_ble_gatts_send_response(
+				gatts_if, param->write.conn_id, param->write.trans_id, ESP_GATT_OK, nullptr);
+		if (errRc != ESP_OK) {
+			ESP_LOGE(LOG_TAG, "esp_ble_gatts_send_response: rc=%d %s", errRc, GeneralUtils::errorToString(errRc));
+		}
+	}
+} // handleRawWrite
+
+
 /**
  * @brief Set the Indicate property value.
  * @param [in] value Set to true if we are to allow indicate messages.
@@ -660,6 +1161,31 @@ void BLECharacteristic::setNotifyProperty(bool value) {
 } // setNotifyProperty
 
 
+/**
+ * @brief Force the next read to invoke onRead() even though the read cache is fresh.
+ * @return N/A
+ */
+void BLECharacteristic::invalidateReadCache() {
+	m_readCacheValid = false;
+} // invalidateReadCache
+
+
+/**
+ * @brief Cache the value produced by the onRead() callback.
+ *
+ * For a value that changes rarely there is no need to recompute it for every read.  While the cache is fresh,
+ * reads are answered with the current value without invoking onRead().  The value set with setValue() is always
+ * the one served; the cache only decides whether onRead() is called first.
+ * @param [in] ttlMs How long the value stays fresh after onRead(), READ_CACHE_FOREVER to keep it until
+ * invalidateReadCache(), or 0 to invoke onRead() for every read (the default).
+ * @return N/A
+ */
+void BLECharacteristic::setReadCache(uint32_t ttlMs) {
+	m_readCacheTtlMs = ttlMs;
+	m_readCacheValid = false;
+} // setReadCache
+
+
 /**
  * @brief Set the Read property value.
  * @param [in] value Set to true if we are to allow reads.
@@ -676,18 +1202,25 @@ void BLECharacteristic::setReadProperty(bool value) {
 
 /**
  * @brief Set the value of the characteristic.
+ * While notification coalescing is enabled the value is changed under the coalescing lock, since the flush
+ * timer sends the value from another task and a longer value may move it to a new buffer.
  * @param [in] data The data to set for the characteristic.
  * @param [in] length The length of the data in bytes.
  */
 void BLECharacteristic::setValue(uint8_t* data, size_t length) {
-	char *pHex = BLEUtils::buildHexData(nullptr, data, length);
-	ESP_LOGD(LOG_TAG, ">> setValue: length=%d, data=%s, characteristic UUID=%s", length, pHex, getUUID().toString().c_str());
-	free(pHex);
+	// No hex dump of the data here; building one would allocate on every update of the value.
+	ESP_LOGD(LOG_TAG, ">> setValue: length=%d, characteristic UUID=%s", length, getUUID().toString().c_str());
 	if (length > ESP_GATT_MAX_ATTR_LEN) {
 		ESP_LOGE(LOG_TAG, "Size %d too large, must be no bigger than %d", length, ESP_GATT_MAX_ATTR_LEN);
 		return;
 	}
-	m_value.setValue(data, length);
+	if (m_coalesceMode != COALESCE_NONE) {
+		m_semaphoreCoalesce.take("setValue");
+		m_value.setValue(data, length);
+		m_semaphoreCoalesce.give();
+	} else {
+		m_value.setValue(data, length);
+	}
 	ESP_LOGD(LOG_TAG, "<< setValue");
 } // setValue
 
@@ -810,4 +1343,20 @@ void BLECharacteristicCallbacks::onWrite(BLECharacteristic *pCharacteristic) {
 	ESP_LOGD("BLECharacteristicCallbacks", "<< onWrite");
 } // onWrite
 
+
+/**
+ * @brief Callback function reporting the outcome of an indication queued with indicateAsync().
+ * @param [in] pCharacteristic The characteristic that was indicated.
+ * @param [in] status The outcome of the indication.
+ * @param [in] connId The connection on which the indication was sent.
+ * @param [in] code The error code for ERROR_GATT.
+ */
+void BLECharacteristicCallbacks::onStatus(BLECharacteristic* pCharacteristic, Status status, uint16_t connId, uint32_t code) {
+	ESP_LOGD("BLECharacteristicCallbacks", ">> onStatus: default");
+	ESP_LOGD("BLECharacteristicCallbacks", "<< onStatus");
+} // onStatus
+
+
+BLEWriteSink::~BLEWriteSink() {}
+
 #endif /* CONFIG_BT_ENABLED */
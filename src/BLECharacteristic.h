@@ -17,10 +17,13 @@
 #include "BLEDescriptor.h"
 #include "BLEValue.h"
 #include "FreeRTOS.h"
+#include <freertos/timers.h>
 
 class BLEService;
 class BLEDescriptor;
 class BLECharacteristicCallbacks;
+class BLEWriteSink;
+class BLECallbackExecutor;
 
 /**
  * @brief A management structure for %BLE descriptors.
@@ -40,6 +43,7 @@ public:
 			esp_ble_gatts_cb_param_t* param);
 	BLEDescriptor* getFirst();
 	BLEDescriptor* getNext();
+	size_t         getMemoryUsage();
 private:
 	std::map<std::string, BLEDescriptor *> m_uuidMap;
 	std::map<uint16_t,    BLEDescriptor *> m_handleMap;
@@ -60,20 +64,33 @@ public:
 	virtual ~BLECharacteristic();
 
 	void           addDescriptor(BLEDescriptor* pDescriptor);
+	uint16_t       deferReadResponse();
 	BLEDescriptor* getDescriptorByUUID(const char* descriptorUUID);
 	BLEDescriptor* getDescriptorByUUID(BLEUUID descriptorUUID);
 	//size_t         getLength();
+	uint32_t       getReadCacheHits();
+	uint32_t       getReadCacheMisses();
 	BLEUUID        getUUID();
 	std::string    getValue();
+	BLESpan        getValueSpan();
 	uint8_t*       getData();
+	size_t         getMemoryUsage();
 	size_t 		   getDataSize();
 
+	void flushNotify();
 	void indicate();
+	bool indicateAsync();
+	bool indicateAsync(uint16_t connId);
+	void invalidateReadCache();
 	void notify();
 	void setBroadcastProperty(bool value);
+	void sendReadResponse(uint16_t connId);
+	void setCallbackExecutor(BLECallbackExecutor* pExecutor);
 	void setCallbacks(BLECharacteristicCallbacks* pCallbacks);
 	void setIndicateProperty(bool value);
+	void setNotifyCoalescing(uint8_t mode, uint32_t flushIntervalMs = 20);
 	void setNotifyProperty(bool value);
+	void setReadCache(uint32_t ttlMs);
 	void setReadProperty(bool value);
 	void setValue(uint8_t* data, size_t size);
 	void setValue(std::string value);
@@ -84,6 +101,7 @@ public:
 	void setValue(double& data64); 
 	void setWriteProperty(bool value);
 	void setWriteNoResponseProperty(bool value);
+	void setWriteSink(BLEWriteSink* pSink);
 	std::string toString();
 	uint16_t getHandle();
 	void setAccessPermissions(esp_gatt_perm_t perm);
@@ -95,22 +113,44 @@ public:
 	static const uint32_t PROPERTY_INDICATE  = 1<<4;
 	static const uint32_t PROPERTY_WRITE_NR  = 1<<5;
 
+	static const uint32_t READ_CACHE_FOREVER = UINT32_MAX;   // Cached until invalidateReadCache().
+
+	static const uint8_t COALESCE_NONE   = 0;   // Every notify() is sent immediately.
+	static const uint8_t COALESCE_LATEST = 1;   // Only the latest value is sent at each flush.
+	static const uint8_t COALESCE_APPEND = 2;   // The values are appended and sent as one packet at each flush.
+
 private:
 
 	friend class BLEServer;
 	friend class BLEService;
 	friend class BLEDescriptor;
 	friend class BLECharacteristicMap;
+	friend class BLEIndicationQueue;
 
 	BLEUUID                     m_bleUUID;
 	BLEDescriptorMap            m_descriptorMap;
 	uint16_t                    m_handle;
 	esp_gatt_char_prop_t        m_properties;
 	BLECharacteristicCallbacks* m_pCallbacks;
+	BLECallbackExecutor*        m_pExecutor;
+	BLEWriteSink*               m_pWriteSink;
 	BLEService*                 m_pService;
 	BLEValue                    m_value;
 	esp_gatt_perm_t             m_permissions = ESP_GATT_PERM_READ | ESP_GATT_PERM_WRITE;
-	bool						m_writeEvt = false;
+	std::map<uint16_t, std::string> m_readSnapshots;   // Value frozen at the start of a long read, by conn_id.
+	uint32_t                    m_readCacheTtlMs;    // 0 when onRead() is invoked for every read.
+	bool                        m_readCacheValid;
+	uint32_t                    m_readCacheTime;     // When onRead() last refreshed the value.
+	uint32_t                    m_readCacheHits;
+	uint32_t                    m_readCacheMisses;
+	uint8_t                     m_coalesceMode;
+	bool                        m_coalescePending;   // COALESCE_LATEST: a notify() arrived since the last flush.
+	std::string                 m_coalesceBuffer;    // COALESCE_APPEND: the values appended since the last flush.
+	TimerHandle_t               m_coalesceTimer;
+	uint16_t                    m_readConnId;        // The read being passed to onRead(), under BLEServer::m_semaphoreOnRead.
+	uint32_t                    m_readTransId;
+	bool                        m_readDeferred;      // onRead() called deferReadResponse().
+	std::map<uint16_t, uint32_t> m_deferredReads;    // Reads awaiting sendReadResponse(): conn_id to trans_id.
 
 	void handleGATTServerEvent(
 			esp_gatts_cb_event_t      event,
@@ -119,10 +159,22 @@ private:
 
 	void                 executeCreate(BLEService* pService);
 	esp_gatt_char_prop_t getProperties();
+	void                 handleRawWrite(esp_gatt_if_t gatts_if, esp_ble_gatts_cb_param_t* param);
+	void                 registerWriteSink();
+	size_t               notifyPacketSize(uint16_t connId);
+	void                 sendNotify(uint8_t* pData, size_t length, bool waitConf = true);
+	bool                 invokeOnRead(uint16_t connId, uint32_t transId);
+	void                 invokeOnWrite();
+	void                 markReadCacheFresh();
+	void                 sendReadResponse(esp_gatt_if_t gatts_if, uint16_t connId, uint32_t transId);
+	static void          deferredRead(void* pObject, esp_ble_gatts_cb_param_t* param);
+	static void          deferredWrite(void* pObject, esp_ble_gatts_cb_param_t* param);
+	static void          coalesceTimerCallback(TimerHandle_t timer);
 	BLEService*          getService();
 	void                 setHandle(uint16_t handle);
 	FreeRTOS::Semaphore m_semaphoreCreateEvt = FreeRTOS::Semaphore("CreateEvt");
 	FreeRTOS::Semaphore m_semaphoreConfEvt   = FreeRTOS::Semaphore("ConfEvt");
+	FreeRTOS::Semaphore m_semaphoreCoalesce  = FreeRTOS::Semaphore("Coalesce");
 }; // BLECharacteristic
 
 
@@ -135,9 +187,35 @@ private:
  */
 class BLECharacteristicCallbacks {
 public:
+	typedef enum {
+		SUCCESS_INDICATE,         // The client confirmed the indication.
+		ERROR_INDICATE_DISABLED,  // The client has not enabled indications.
+		ERROR_NO_CLIENT,          // There is no connection, or it was closed before the indication was confirmed.
+		ERROR_GATT,               // The stack reported an error; the code is the esp_err_t or esp_gatt_status_t.
+		ERROR_INDICATE_TIMEOUT,   // The client did not confirm the indication in time.
+		ERROR_QUEUE_FULL,         // Too many indications are already queued on the connection.
+	} Status;
+
 	virtual ~BLECharacteristicCallbacks();
 	virtual void onRead(BLECharacteristic* pCharacteristic);
 	virtual void onWrite(BLECharacteristic* pCharacteristic);
+	virtual void onStatus(BLECharacteristic* pCharacteristic, Status status, uint16_t connId, uint32_t code);
+};
+
+
+/**
+ * @brief A raw destination for the data written to a %BLE characteristic.
+ *
+ * When a sink is attached to a characteristic, every (non prepared) write received for it is handed to the
+ * sink directly from the %BLE event, before any other service or characteristic sees the event.  The data is
+ * not copied into the characteristic value and the onWrite() callback is not invoked.  The data pointer is
+ * only valid for the duration of the call so an implementation would typically append it to a ring buffer
+ * drained by another task.  The call is made on the %BLE task and so must not block.
+ */
+class BLEWriteSink {
+public:
+	virtual ~BLEWriteSink();
+	virtual void onData(const uint8_t* pData, size_t length, uint16_t connId) = 0;
 };
 #endif /* CONFIG_BT_ENABLED */
 #endif /* COMPONENTS_CPP_UTILS_BLECHARACTERISTIC_H_ */
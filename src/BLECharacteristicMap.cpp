@@ -8,11 +8,22 @@
 #if defined(CONFIG_BT_ENABLED)
 #include <sstream>
 #include <iomanip>
+#include <algorithm>
 #include "BLEService.h"
 #ifdef ARDUINO_ARCH_ESP32
 #include "esp32-hal-log.h"
 #endif
 
+static const size_t MAP_NODE_OVERHEAD = 4 * sizeof(void*);   // Colour and links of a std::map node.
+
+
+/**
+ * @brief Order UUID index entries by their key.
+ */
+static bool compareKey(const std::pair<BLEUUIDKey, BLECharacteristic*>& entry, const BLEUUIDKey& key) {
+	return entry.first < key;
+} // compareKey
+
 
 /**
  * @brief Return the characteristic by handle.
@@ -40,12 +51,11 @@ BLECharacteristic* BLECharacteristicMap::getByUUID(const char* uuid) {
  * @return The characteristic.
  */
 BLECharacteristic* BLECharacteristicMap::getByUUID(BLEUUID uuid) {
-	for (auto &myPair : m_uuidMap) {
-		if (myPair.first->getUUID().equals(uuid)) {
-			return myPair.first;
-		}
+	BLEUUIDKey key = uuid.getKey();
+	auto it = std::lower_bound(m_uuidIndex.begin(), m_uuidIndex.end(), key, compareKey);
+	if (it != m_uuidIndex.end() && it->first == key) {
+		return it->second;
 	}
-	//return m_uuidMap.at(uuid.toString());
 	return nullptr;
 } // getByUUID
 
@@ -55,13 +65,8 @@ BLECharacteristic* BLECharacteristicMap::getByUUID(BLEUUID uuid) {
  * @return The first characteristic in the map.
  */
 BLECharacteristic* BLECharacteristicMap::getFirst() {
-	m_iterator = m_uuidMap.begin();
-	if (m_iterator == m_uuidMap.end()) {
-		return nullptr;
-	}
-	BLECharacteristic* pRet = m_iterator->first;
-	m_iterator++;
-	return pRet;
+	m_iterator = 0;
+	return getNext();
 } // getFirst
 
 
@@ -70,12 +75,10 @@ BLECharacteristic* BLECharacteristicMap::getFirst() {
  * @return The next characteristic in the map.
  */
 BLECharacteristic* BLECharacteristicMap::getNext() {
-	if (m_iterator == m_uuidMap.end()) {
+	if (m_iterator >= m_characteristics.size()) {
 		return nullptr;
 	}
-	BLECharacteristic* pRet = m_iterator->first;
-	m_iterator++;
-	return pRet;
+	return m_characteristics[m_iterator++];
 } // getNext
 
 
@@ -90,8 +93,8 @@ void BLECharacteristicMap::handleGATTServerEvent(
 		esp_gatt_if_t             gatts_if,
 		esp_ble_gatts_cb_param_t* param) {
 	// Invoke the handler for every Service we have.
-	for (auto &myPair : m_uuidMap) {
-		myPair.first->handleGATTServerEvent(event, gatts_if, param);
+	for (size_t i = 0; i < m_characteristics.size(); i++) {
+		m_characteristics[i]->handleGATTServerEvent(event, gatts_if, param);
 	}
 } // handleGATTServerEvent
 
@@ -104,10 +107,30 @@ void BLECharacteristicMap::handleGATTServerEvent(
  */
 void BLECharacteristicMap::setByHandle(uint16_t handle,
 		BLECharacteristic *characteristic) {
-	m_handleMap.insert(std::pair<uint16_t, BLECharacteristic *>(handle, characteristic));
+	m_handleMap[handle] = characteristic;   // The stack may reuse the handle of a deleted service.
 } // setByHandle
 
 
+/**
+ * @brief Get the heap used by the map itself.
+ * @return The size of the containers, not including the characteristics.
+ */
+size_t BLECharacteristicMap::getMemoryUsage() {
+	return m_characteristics.capacity() * sizeof(BLECharacteristic*) +
+		m_uuidIndex.capacity() * sizeof(std::pair<BLEUUIDKey, BLECharacteristic*>) +
+		m_handleMap.size() * (MAP_NODE_OVERHEAD + sizeof(std::pair<const uint16_t, BLECharacteristic*>));
+} // getMemoryUsage
+
+
+/**
+ * @brief Forget the handles of all the characteristics.
+ * @return N/A.
+ */
+void BLECharacteristicMap::removeHandles() {
+	m_handleMap.clear();
+} // removeHandles
+
+
 /**
  * @brief Set the characteristic by UUID.
  * @param [in] uuid The uuid of the characteristic.
@@ -117,7 +140,15 @@ void BLECharacteristicMap::setByHandle(uint16_t handle,
 void BLECharacteristicMap::setByUUID(
 		BLECharacteristic *pCharacteristic,
 		BLEUUID            uuid) {
-	m_uuidMap.insert(std::pair<BLECharacteristic *, std::string>(pCharacteristic, uuid.toString()));
+	if (std::find(m_characteristics.begin(), m_characteristics.end(), pCharacteristic) != m_characteristics.end()) {
+		return;
+	}
+	m_characteristics.push_back(pCharacteristic);
+	// Characteristics sharing a UUID are kept in the order they were added.
+	BLEUUIDKey key = uuid.getKey();
+	auto it = std::upper_bound(m_uuidIndex.begin(), m_uuidIndex.end(), key,
+		[](const BLEUUIDKey& k, const std::pair<BLEUUIDKey, BLECharacteristic*>& entry) { return k < entry.first; });
+	m_uuidIndex.insert(it, std::pair<BLEUUIDKey, BLECharacteristic*>(key, pCharacteristic));
 } // setByUUID
 
 
@@ -129,12 +160,12 @@ std::string BLECharacteristicMap::toString() {
 	std::stringstream stringStream;
 	stringStream << std::hex << std::setfill('0');
 	int count=0;
-	for (auto &myPair: m_uuidMap) {
+	for (auto pCharacteristic: m_characteristics) {
 		if (count > 0) {
 			stringStream << "\n";
 		}
 		count++;
-		stringStream << "handle: 0x" << std::setw(2) << myPair.first->getHandle() << ", uuid: " + myPair.first->getUUID().toString();
+		stringStream << "handle: 0x" << std::setw(2) << pCharacteristic->getHandle() << ", uuid: " + pCharacteristic->getUUID().toString();
 	}
 	return stringStream.str();
 } // toString
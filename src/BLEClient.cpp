@@ -12,6 +12,8 @@
 #include <esp_gap_ble_api.h>
 #include <esp_gattc_api.h>
 #include "BLEClient.h"
+#include "BLEDevice.h"
+#include "BLEDiscoveryCache.h"
 #include "BLEUtils.h"
 #include "BLEService.h"
 #include "GeneralUtils.h"
@@ -46,10 +48,16 @@ static const char* LOG_TAG = "BLEClient";
 
 BLEClient::BLEClient() {
 	m_pClientCallbacks = nullptr;
+	m_appId            = 0;
 	m_conn_id          = 0;
+	m_mtu              = 23;
 	m_gattc_if         = 0;
 	m_haveServices     = false;
 	m_isConnected      = false;  // Initially, we are flagged as not connected.
+	m_connectAsync     = false;
+	m_deleteOnUnregister = false;
+	m_pRequestQueue    = new BLERemoteRequestQueue(this);
+	m_useDiscoveryCache = false;
 } // BLEClient
 
 
@@ -59,10 +67,13 @@ BLEClient::BLEClient() {
 BLEClient::~BLEClient() {
 	// We may have allocated service references associated with this client.  Before we are finished
 	// with the client, we must release resources.
+	BLEDevice::removeClient(this);
+	m_pRequestQueue->release();
 	for (auto &myPair : m_servicesMap) {
 	   delete myPair.second;
 	}
 	m_servicesMap.clear();
+	delete m_pRequestQueue;
 } // ~BLEClient
 
 
@@ -72,11 +83,13 @@ BLEClient::~BLEClient() {
  */
 void BLEClient::clearServices() {
 	ESP_LOGD(LOG_TAG, ">> clearServices");
+	m_pRequestQueue->release();   // Requests refer to the characteristics.
 	// Delete all the services.
 	for (auto &myPair : m_servicesMap) {
 	   delete myPair.second;
 	}
 	m_servicesMap.clear();
+	m_characteristicsByHandle.clear();
 	m_haveServices = false;
 	ESP_LOGD(LOG_TAG, "<< clearServices");
 } // clearServices
@@ -96,7 +109,7 @@ bool BLEClient::connect(BLEAddress address) {
 
 	clearServices(); // Delete any services that may exist.
 
-	esp_err_t errRc = ::esp_ble_gattc_app_register(0);
+	esp_err_t errRc = ::esp_ble_gattc_app_register(m_appId);
 	if (errRc != ESP_OK) {
 		ESP_LOGE(LOG_TAG, "esp_ble_gattc_app_register: rc=%d %s", errRc, GeneralUtils::errorToString(errRc));
 		return false;
@@ -108,14 +121,9 @@ bool BLEClient::connect(BLEAddress address) {
 
 	// Perform the open connection request against the target BLE Server.
 	m_semaphoreOpenEvt.take("connect");
-	errRc = ::esp_ble_gattc_open(
-		getGattcIf(),
-		*getPeerAddress().getNative(), // address
-		BLE_ADDR_TYPE_PUBLIC,          // Note: This was added on 2018-04-03 when the latest ESP-IDF was detected to have changed the signature.
-		1                              // direct connection
-	);
+	errRc = open();
 	if (errRc != ESP_OK) {
-		ESP_LOGE(LOG_TAG, "esp_ble_gattc_open: rc=%d %s", errRc, GeneralUtils::errorToString(errRc));
+		m_semaphoreOpenEvt.give();
 		return false;
 	}
 
@@ -125,6 +133,29 @@ bool BLEClient::connect(BLEAddress address) {
 } // connect
 
 
+/**
+ * @brief Start connecting to the partner (BLE Server) without waiting for the connection.
+ * The outcome is reported to BLEClientCallbacks::onConnect(), after which isConnected() is true if the
+ * connection was made.  The attempt is abandoned by the %BLE stack if the server does not answer.
+ * @param [in] address The address of the partner.
+ * @return True if the attempt was started.
+ */
+bool BLEClient::connectAsync(BLEAddress address) {
+	ESP_LOGD(LOG_TAG, ">> connectAsync(%s)", address.toString().c_str());
+	clearServices(); // Delete any services that may exist.
+	m_peerAddress  = address;
+	m_connectAsync = true;   // The connection is opened when the app is registered.
+	esp_err_t errRc = ::esp_ble_gattc_app_register(m_appId);
+	if (errRc != ESP_OK) {
+		ESP_LOGE(LOG_TAG, "esp_ble_gattc_app_register: rc=%d %s", errRc, GeneralUtils::errorToString(errRc));
+		m_connectAsync = false;
+		return false;
+	}
+	ESP_LOGD(LOG_TAG, "<< connectAsync()");
+	return true;
+} // connectAsync
+
+
 /**
  * @brief Disconnect from the peer.
  * @return N/A.
@@ -162,11 +193,16 @@ void BLEClient::gattClientEventHandler(
 		// - esp_bd_addr_t     remote_bda
 		case ESP_GATTC_DISCONNECT_EVT: {
 				// If we receive a disconnect event, set the class flag that indicates that we are
-				// no longer connected.
+				// no longer connected.  Every registered app is told of every disconnection, so ignore
+				// those of connections that are not ours.
+				if (!m_isConnected || evtParam->disconnect.conn_id != m_conn_id) {
+					break;
+				}
 				if (m_pClientCallbacks != nullptr) {
 					m_pClientCallbacks->onDisconnect(this);
 				}
 				m_isConnected = false;
+				m_pRequestQueue->release();
 				m_semaphoreRssiCmplEvt.give();
 				m_semaphoreSearchCmplEvt.give(1);
 				break;
@@ -183,17 +219,48 @@ void BLEClient::gattClientEventHandler(
 		//
 		case ESP_GATTC_OPEN_EVT: {
 			m_conn_id = evtParam->open.conn_id;
+			m_mtu     = 23;
+			if (evtParam->open.status == ESP_GATT_OK) {
+				m_isConnected = true;   // Flag us as connected, before onConnect() so that it can tell success from failure.
+			}
 			if (m_pClientCallbacks != nullptr) {
 				m_pClientCallbacks->onConnect(this);
 			}
-			if (evtParam->open.status == ESP_GATT_OK) {
-				m_isConnected = true;   // Flag us as connected.
-			}
 			m_semaphoreOpenEvt.give(evtParam->open.status);
 			break;
 		} // ESP_GATTC_OPEN_EVT
 
 
+		//
+		// ESP_GATTC_CFG_MTU_EVT
+		//
+		// cfg_mtu:
+		// - esp_gatt_status_t status
+		// - uint16_t          conn_id
+		// - uint16_t          mtu
+		//
+		case ESP_GATTC_CFG_MTU_EVT: {
+			if (evtParam->cfg_mtu.status == ESP_GATT_OK && evtParam->cfg_mtu.conn_id == m_conn_id) {
+				m_mtu = evtParam->cfg_mtu.mtu;
+			}
+			break;
+		} // ESP_GATTC_CFG_MTU_EVT
+
+		//
+		// ESP_GATTC_CONGEST_EVT
+		//
+		// congest:
+		// - uint16_t conn_id
+		// - bool     congested
+		//
+		case ESP_GATTC_CONGEST_EVT: {
+			if (evtParam->congest.conn_id == m_conn_id) {
+				m_pRequestQueue->setCongested(evtParam->congest.congested);
+			}
+			break;
+		} // ESP_GATTC_CONGEST_EVT
+
+
 		//
 		// ESP_GATTC_REG_EVT
 		//
@@ -203,11 +270,36 @@ void BLEClient::gattClientEventHandler(
 		//
 		case ESP_GATTC_REG_EVT: {
 			m_gattc_if = gattc_if;
+			if (m_connectAsync) {
+				m_connectAsync = false;
+				if (evtParam->reg.status != ESP_GATT_OK) {
+					ESP_LOGE(LOG_TAG, "App registration failed: status=%d", evtParam->reg.status);
+				}
+				if ((evtParam->reg.status != ESP_GATT_OK || open() != ESP_OK) && m_pClientCallbacks != nullptr) {
+					m_pClientCallbacks->onConnect(this);   // Report the failure; isConnected() is false.
+				}
+			}
 			m_semaphoreRegEvt.give();
 			break;
 		} // ESP_GATTC_REG_EVT
 
 
+		//
+		// ESP_GATTC_SRVC_CHG_EVT
+		//
+		// srvc_chg:
+		// - esp_bd_addr_t remote_bda
+		//
+		case ESP_GATTC_SRVC_CHG_EVT: {
+			// The server's database has changed, so what we know of it is stale.
+			BLEDiscoveryCache::erase(BLEAddress(evtParam->srvc_chg.remote_bda));
+			if (BLEAddress(evtParam->srvc_chg.remote_bda).equals(m_peerAddress)) {
+				m_haveServices = false;   // Discover the services again on the next getService().
+			}
+			break;
+		} // ESP_GATTC_SRVC_CHG_EVT
+
+
 		//
 		// ESP_GATTC_SEARCH_CMPL_EVT
 		//
@@ -248,6 +340,32 @@ void BLEClient::gattClientEventHandler(
 		}
 	} // Switch
 
+	// Notifications go straight to their characteristic, and the completions of requests to the request queue.
+	switch(event) {
+		case ESP_GATTC_NOTIFY_EVT: {
+			auto it = m_characteristicsByHandle.find(evtParam->notify.handle);
+			if (it != m_characteristicsByHandle.end()) {
+				it->second->gattClientEventHandler(event, gattc_if, evtParam);
+			}
+			return;
+		}
+		case ESP_GATTC_READ_CHAR_EVT:
+		case ESP_GATTC_READ_MULTIPLE_EVT:
+			m_pRequestQueue->complete(event, evtParam->read.handle, evtParam->read.status, evtParam->read.value, evtParam->read.value_len);
+			return;
+		case ESP_GATTC_WRITE_CHAR_EVT:
+			m_pRequestQueue->complete(event, evtParam->write.handle, evtParam->write.status, nullptr, 0);
+			return;
+		case ESP_GATTC_REG_FOR_NOTIFY_EVT:
+			m_pRequestQueue->complete(event, evtParam->reg_for_notify.handle, evtParam->reg_for_notify.status, nullptr, 0);
+			return;
+		case ESP_GATTC_UNREG_FOR_NOTIFY_EVT:
+			m_pRequestQueue->complete(event, evtParam->unreg_for_notify.handle, evtParam->unreg_for_notify.status, nullptr, 0);
+			return;
+		default:
+			break;
+	}
+
 	// Pass the request on to all services.
 	for (auto &myPair : m_servicesMap) {
 	   myPair.second->gattClientEventHandler(event, gattc_if, evtParam);
@@ -267,6 +385,25 @@ esp_gatt_if_t BLEClient::getGattcIf() {
 } // getGattcIf
 
 
+/**
+ * @brief Ask the %BLE stack to open the connection to the peer.
+ * Completion is reported by ESP_GATTC_OPEN_EVT.
+ * @return The result of the request.
+ */
+esp_err_t BLEClient::open() {
+	esp_err_t errRc = ::esp_ble_gattc_open(
+		getGattcIf(),
+		*getPeerAddress().getNative(), // address
+		BLE_ADDR_TYPE_PUBLIC,          // Note: This was added on 2018-04-03 when the latest ESP-IDF was detected to have changed the signature.
+		1                              // direct connection
+	);
+	if (errRc != ESP_OK) {
+		ESP_LOGE(LOG_TAG, "esp_ble_gattc_open: rc=%d %s", errRc, GeneralUtils::errorToString(errRc));
+	}
+	return errRc;
+} // open
+
+
 /**
  * @brief Retrieve the address of the peer.
  *
@@ -277,6 +414,25 @@ BLEAddress BLEClient::getPeerAddress() {
 } // getAddress
 
 
+/**
+ * @brief Get the link layer data length negotiated with the remote %BLE Server.
+ * See BLEDevice::setDataLength().
+ * @return The payload of a link layer packet sent to the server, 27 until Data Length Extension has been negotiated.
+ */
+uint16_t BLEClient::getDataLength() {
+	return BLEDevice::getDataLength(m_peerAddress);
+} // getDataLength
+
+
+/**
+ * @brief Get the ATT MTU of the connection.
+ * @return The MTU agreed with the server, 23 until it has been exchanged.
+ */
+uint16_t BLEClient::getMTU() {
+	return m_mtu;
+} // getMTU
+
+
 /**
  * @brief Ask the BLE server for the RSSI value.
  * @return The RSSI value.
@@ -359,6 +515,12 @@ std::map<std::string, BLERemoteService*>* BLEClient::getServices() {
 
 	clearServices(); // Clear any services that may exist.
 
+	if (m_useDiscoveryCache && BLEDiscoveryCache::restore(this)) {
+		m_haveServices = true;
+		ESP_LOGD(LOG_TAG, "<< getServices: from the discovery cache");
+		return &m_servicesMap;
+	}
+
 	esp_err_t errRc = esp_ble_gattc_search_service(
 		getGattcIf(),
 		getConnId(),
@@ -371,6 +533,9 @@ std::map<std::string, BLERemoteService*>* BLEClient::getServices() {
 	}
 	// If sucessfull, remember that we now have services.
 	m_haveServices = (m_semaphoreSearchCmplEvt.wait("getServices") == 0);
+	if (m_haveServices && m_useDiscoveryCache) {
+		BLEDiscoveryCache::save(this);
+	}
 	ESP_LOGD(LOG_TAG, "<< getServices");
 	return &m_servicesMap;
 } // getServices
@@ -410,6 +575,9 @@ void BLEClient::handleGAPEvent(
 		// - esp_bd_addr_t remote_addr
 		//
 		case ESP_GAP_BLE_READ_RSSI_COMPLETE_EVT: {
+			if (!BLEAddress(param->read_rssi_cmpl.remote_addr).equals(m_peerAddress)) {
+				break;   // The RSSI of another client's server.
+			}
 			m_semaphoreRssiCmplEvt.give((uint32_t)param->read_rssi_cmpl.rssi);
 			break;
 		} // ESP_GAP_BLE_READ_RSSI_COMPLETE_EVT
@@ -431,6 +599,70 @@ bool BLEClient::isConnected() {
 
 
 
+/**
+ * @brief Read the values of several characteristics with as few round trips as possible.
+ *
+ * The value of characteristic i is copied into pBuffer at the offset sizes[0] + ... + sizes[i-1], truncated
+ * to sizes[i] bytes, and its length is stored in lengths[i]; a value that could not be read has length 0.
+ * The reads are queued together and sent back to back, without waiting on the caller between them.
+ *
+ * If the values have fixed sizes, and sizes[] gives them exactly, neighbouring characteristics are read
+ * with a single ATT Read Multiple request, as many as fit in one response.  A server that does not support
+ * Read Multiple has its values read one by one instead.
+ *
+ * @param [in] ppCharacteristics The characteristics to read.
+ * @param [in] count The number of characteristics.
+ * @param [out] pBuffer The buffer for the values, at least the sum of sizes[] long.
+ * @param [in] sizes The space for each value, or its exact size when fixedSizes is set.
+ * @param [out] lengths The length of each value read.
+ * @param [in] fixedSizes True if sizes[] are the exact sizes of the values.
+ * @return True if every value was read.
+ * @throws BLEDisconnectedException
+ */
+bool BLEClient::readValues(BLERemoteCharacteristic** ppCharacteristics, size_t count, uint8_t* pBuffer,
+		const uint16_t* sizes, uint16_t* lengths, bool fixedSizes) {
+	ESP_LOGD(LOG_TAG, ">> readValues: %d characteristics", count);
+	if (!isConnected()) {
+		ESP_LOGE(LOG_TAG, "Disconnected");
+		throw BLEDisconnectedException();
+	}
+	if (count == 0) {
+		return true;
+	}
+
+	// Group the reads.  A Read Multiple response is a single PDU, so its values must fit in MTU - 1 bytes.
+	std::vector<BLERemoteRequestQueue::Slot> slots(count);
+	std::vector<uint8_t> groups;
+	size_t maxBytes   = getMTU() - 1;
+	size_t groupBytes = 0;
+	size_t offset     = 0;
+	for (size_t i = 0; i < count; i++) {
+		slots[i].pCharacteristic = ppCharacteristics[i];
+		slots[i].pBuffer         = pBuffer + offset;
+		slots[i].size            = sizes[i];
+		slots[i].pLength         = &lengths[i];
+		offset += sizes[i];
+		if (fixedSizes && !groups.empty() && groups.back() < ESP_GATT_MAX_READ_MULTI_HANDLES && groupBytes + sizes[i] <= maxBytes) {
+			groups.back()++;
+			groupBytes += sizes[i];
+		} else {
+			groups.push_back(1);
+			groupBytes = sizes[i];
+		}
+	}
+
+	FreeRTOS::Semaphore semaphore("ReadValues");
+	BLERemoteRequestQueue::Batch batch;
+	batch.pSemaphore = &semaphore;
+	semaphore.take("readValues");
+	m_pRequestQueue->enqueueReads(&batch, slots, groups);
+	m_pRequestQueue->waitReads(&batch);
+
+	ESP_LOGD(LOG_TAG, "<< readValues: %d requests, status=%d", groups.size(), batch.status);
+	return batch.status == ESP_GATT_OK;
+} // readValues
+
+
 /**
  * @brief Set the callbacks that will be invoked.
  */
@@ -439,6 +671,28 @@ void BLEClient::setClientCallbacks(BLEClientCallbacks* pClientCallbacks) {
 } // setClientCallbacks
 
 
+/**
+ * @brief Cache the services discovered on servers.
+ * With the cache enabled, the services, characteristics and descriptors of a server are saved in NVS when
+ * they are first discovered, and restored from there on later connections to the same server rather than
+ * being discovered again.  See BLEDiscoveryCache for how a stale cache is detected.
+ * @param [in] enabled True to use the cache.
+ */
+void BLEClient::setDiscoveryCache(bool enabled) {
+	m_useDiscoveryCache = enabled;
+} // setDiscoveryCache
+
+
+/**
+ * @brief Set the most requests that may be queued on the connection, including the one in flight.
+ * Reads and writes made when the queue is full fail.  See BLERemoteRequestQueue.
+ * @param [in] maxQueued The maximum number of requests.
+ */
+void BLEClient::setMaxQueuedRequests(uint8_t maxQueued) {
+	m_pRequestQueue->setMaxQueued(maxQueued);
+} // setMaxQueuedRequests
+
+
 /**
  * @brief Set the value of a specific characteristic associated with a specific service.
  * @param [in] serviceUUID The service that owns the characteristic.
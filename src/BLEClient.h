@@ -15,12 +15,16 @@
 #include <string.h>
 #include <map>
 #include <string>
+#include <unordered_map>
+#include <vector>
 #include "BLEExceptions.h"
+#include "BLERemoteRequestQueue.h"
 #include "BLERemoteService.h"
 #include "BLEService.h"
 #include "BLEAddress.h"
 
 class BLERemoteService;
+class BLERemoteCharacteristic;
 class BLEClientCallbacks;
 
 /**
@@ -32,13 +36,18 @@ public:
 	~BLEClient();
 
 	bool                                       connect(BLEAddress address);   // Connect to the remote BLE Server
+	bool                                       connectAsync(BLEAddress address);   // Start connecting to the remote BLE Server
 	void                                       disconnect();                  // Disconnect from the remote BLE Server
+	uint16_t                                   getDataLength();               // Get the link layer data length negotiated with the remote BLE Server
+	uint16_t                                   getMTU();                      // Get the ATT MTU of the connection
 	BLEAddress                                 getPeerAddress();              // Get the address of the remote BLE Server
 	int                                        getRssi();                     // Get the RSSI of the remote BLE Server
 	std::map<std::string, BLERemoteService*>*  getServices();                 // Get a map of the services offered by the remote BLE Server
 	BLERemoteService*                          getService(const char* uuid);  // Get a reference to a specified service offered by the remote BLE server.
 	BLERemoteService*                          getService(BLEUUID uuid);      // Get a reference to a specified service offered by the remote BLE server.
 	std::string                                getValue(BLEUUID serviceUUID, BLEUUID characteristicUUID);   // Get the value of a given characteristic at a given service.
+	bool                                       readValues(BLERemoteCharacteristic** ppCharacteristics, size_t count, uint8_t* pBuffer,
+	                                                      const uint16_t* sizes, uint16_t* lengths, bool fixedSizes = false);   // Read several characteristics at once.
 
 
 	void                                       handleGAPEvent(
@@ -48,6 +57,8 @@ public:
 	bool                                       isConnected();                 // Return true if we are connected.
 
 	void                                       setClientCallbacks(BLEClientCallbacks *pClientCallbacks);
+	void                                       setDiscoveryCache(bool enabled);  // Cache the discovered services in NVS.
+	void                                       setMaxQueuedRequests(uint8_t maxQueued);   // Limit the requests queued on the connection.
 	void                                       setValue(BLEUUID serviceUUID, BLEUUID characteristicUUID, std::string value);   // Set the value of a given characteristic at a given service.
 
 	std::string                                toString();                    // Return a string representation of this client.
@@ -58,6 +69,8 @@ private:
 	friend class BLERemoteService;
 	friend class BLERemoteCharacteristic;
 	friend class BLERemoteDescriptor;
+	friend class BLEDiscoveryCache;
+	friend class BLERemoteRequestQueue;
 
 	void                                       gattClientEventHandler(
 		esp_gattc_cb_event_t event,
@@ -67,19 +80,28 @@ private:
 	uint16_t                                   getConnId();
 	esp_gatt_if_t                              getGattcIf();
 	BLEAddress    m_peerAddress = BLEAddress((uint8_t*)"\0\0\0\0\0\0");   // The BD address of the remote server.
+	uint16_t      m_appId;           // The id of the GATT client app we register, unique to this client.
 	uint16_t      m_conn_id;
+	uint16_t      m_mtu;             // The ATT MTU of the connection.
 //	int           m_deviceType;
 	esp_gatt_if_t m_gattc_if;
 	bool          m_haveServices;    // Have we previously obtain the set of services from the remote server.
 	bool          m_isConnected;     // Are we currently connected.
+	bool          m_connectAsync;    // Open the connection as soon as the app is registered.
+	bool          m_deleteOnUnregister;   // Deleted by BLEDevice once ESP_GATTC_UNREG_EVT has been handled.
+	bool          m_useDiscoveryCache;   // Restore services from, and save them to, the BLEDiscoveryCache.
 
 	BLEClientCallbacks* m_pClientCallbacks;
+	BLERemoteRequestQueue* m_pRequestQueue;   // The reads and writes waiting to be sent on the connection.
 	FreeRTOS::Semaphore m_semaphoreRegEvt        = FreeRTOS::Semaphore("RegEvt");
 	FreeRTOS::Semaphore m_semaphoreOpenEvt       = FreeRTOS::Semaphore("OpenEvt");
 	FreeRTOS::Semaphore m_semaphoreSearchCmplEvt = FreeRTOS::Semaphore("SearchCmplEvt");
 	FreeRTOS::Semaphore m_semaphoreRssiCmplEvt   = FreeRTOS::Semaphore("RssiCmplEvt");
 	std::map<std::string, BLERemoteService*> m_servicesMap;
+	std::unordered_map<uint16_t, BLERemoteCharacteristic*> m_characteristicsByHandle;   // Every known characteristic, for event dispatch.
+	std::vector<esp_gattc_db_elem_t>         m_dbBuffer;   // Reused by BLERemoteService::retrieveCharacteristics().
 	void clearServices();   // Clear any existing services.
+	esp_err_t open();       // Open the connection to m_peerAddress.
 
 }; // class BLEDevice
 
@@ -0,0 +1,200 @@
+/*
+ * BLEClientPool.cpp
+ *
+ *  Created on: Oct 19, 2026
+ */
+#include "sdkconfig.h"
+#if defined(CONFIG_BT_ENABLED)
+#include <esp_log.h>
+#include "BLEClientPool.h"
+#include "BLEDevice.h"
+#ifdef ARDUINO_ARCH_ESP32
+#include "esp32-hal-log.h"
+#endif
+
+static const char* LOG_TAG = "BLEClientPool";
+
+
+/**
+ * @brief Create an empty pool.
+ * @param [in] maxClients The most idle clients kept connected.
+ */
+BLEClientPool::BLEClientPool(uint8_t maxClients) {
+	m_maxClients = maxClients;
+} // BLEClientPool
+
+
+BLEClientPool::~BLEClientPool() {
+	clear();
+} // ~BLEClientPool
+
+
+/**
+ * @brief Get a client connected to a server.
+ * A pooled client already connected to the server is returned if there is one; otherwise a new client is
+ * created and connected, first making room by disconnecting the least recently used idle client if the pool
+ * is full.  The new client is reserved in the pool before it connects, so the pool is not locked while the
+ * connection is made; another acquire() of the same server waits for that connection rather than making a
+ * second one.
+ * @param [in] address The address of the server.
+ * @return The connected client, to be returned with release(), or nullptr if no connection could be made.
+ */
+BLEClient* BLEClientPool::acquire(BLEAddress address) {
+	ESP_LOGD(LOG_TAG, ">> acquire: %s", address.toString().c_str());
+	m_semaphorePool.take("acquire");
+	auto it = m_entries.begin();
+	while (it != m_entries.end()) {
+		if (!it->address.equals(address)) {
+			++it;
+			continue;
+		}
+		if (it->connecting) {
+			// Another task is connecting to this server; wait for it to finish and look again.
+			m_semaphorePool.give();
+			FreeRTOS::sleep(10);
+			m_semaphorePool.take("acquire");
+			it = m_entries.begin();
+			continue;
+		}
+		if (it->pClient->isConnected()) {
+			it->users++;
+			m_entries.splice(m_entries.begin(), m_entries, it);   // Now the most recently used.
+			BLEClient* pClient = it->pClient;
+			m_semaphorePool.give();
+			ESP_LOGD(LOG_TAG, "<< acquire: pooled client");
+			return pClient;
+		}
+		if (it->users == 0) {
+			// The connection has dropped; connect afresh below.
+			discard(it->pClient);
+			m_entries.erase(it);
+		}
+		break;
+	}
+
+	trim(m_maxClients > 0 ? m_maxClients - 1 : 0);
+	BLEClient* pClient = BLEDevice::createClient();
+	if (pClient == nullptr && trim(0)) {
+		pClient = BLEDevice::createClient();   // Every client was in use; one has been freed.
+	}
+	if (pClient == nullptr) {
+		m_semaphorePool.give();
+		ESP_LOGE(LOG_TAG, "<< acquire: no client available");
+		return nullptr;
+	}
+	Entry entry = { pClient, address, 1, true };
+	m_entries.push_front(entry);
+	m_semaphorePool.give();
+
+	bool connected = pClient->connect(address);   // Unlocked: the entry is reserved, so it is left alone.
+
+	m_semaphorePool.take("acquire");
+	for (it = m_entries.begin(); it != m_entries.end(); ++it) {
+		if (it->pClient == pClient) {
+			break;
+		}
+	}
+	if (!connected) {
+		m_entries.erase(it);
+		discard(pClient);
+		m_semaphorePool.give();
+		ESP_LOGE(LOG_TAG, "<< acquire: unable to connect to %s", address.toString().c_str());
+		return nullptr;
+	}
+	it->connecting = false;
+	m_semaphorePool.give();
+	ESP_LOGD(LOG_TAG, "<< acquire: new client");
+	return pClient;
+} // acquire
+
+
+/**
+ * @brief Disconnect and delete every idle client in the pool.
+ * Clients still acquired are kept until they are released.
+ */
+void BLEClientPool::clear() {
+	m_semaphorePool.take("clear");
+	trim(0);
+	m_semaphorePool.give();
+} // clear
+
+
+/**
+ * @brief Close the connection of a client and delete it.
+ * The client is deleted by BLEDevice once the %BLE task has finished dispatching its events.
+ * @param [in] pClient The client.
+ */
+void BLEClientPool::discard(BLEClient* pClient) {
+	BLEDevice::deleteClient(pClient);
+} // discard
+
+
+/**
+ * @brief Get the most idle clients kept connected.
+ * @return The most idle clients kept connected.
+ */
+uint8_t BLEClientPool::getMaxClients() {
+	return m_maxClients;
+} // getMaxClients
+
+
+/**
+ * @brief Return a client got from acquire().
+ * The client stays connected for the next acquire() of its server, unless the pool is over its limit.
+ * @param [in] pClient The client.
+ */
+void BLEClientPool::release(BLEClient* pClient) {
+	m_semaphorePool.take("release");
+	for (auto it = m_entries.begin(); it != m_entries.end(); ++it) {
+		if (it->pClient != pClient) {
+			continue;
+		}
+		if (it->users > 0) {
+			it->users--;
+		}
+		if (it->users == 0 && !pClient->isConnected()) {
+			discard(pClient);
+			m_entries.erase(it);
+		}
+		break;
+	}
+	trim(m_maxClients);
+	m_semaphorePool.give();
+} // release
+
+
+/**
+ * @brief Set the most idle clients kept connected.
+ * @param [in] maxClients The most idle clients kept connected.
+ */
+void BLEClientPool::setMaxClients(uint8_t maxClients) {
+	m_semaphorePool.take("setMaxClients");
+	m_maxClients = maxClients;
+	trim(m_maxClients);
+	m_semaphorePool.give();
+} // setMaxClients
+
+
+/**
+ * @brief Discard the least recently used idle clients until the pool holds no more than a number of clients.
+ * Clients in use are never discarded, so the pool may stay over the number.  Called with the pool locked.
+ * @param [in] maxClients The most clients to keep.
+ * @return True if a client was discarded.
+ */
+bool BLEClientPool::trim(size_t maxClients) {
+	bool discarded = false;
+	auto it = m_entries.end();
+	while (m_entries.size() > maxClients && it != m_entries.begin()) {
+		--it;
+		if (it->users > 0) {
+			continue;
+		}
+		ESP_LOGD(LOG_TAG, "Discarding the client of %s", it->address.toString().c_str());
+		discard(it->pClient);
+		it = m_entries.erase(it);
+		discarded = true;
+	}
+	return discarded;
+} // trim
+
+#endif /* CONFIG_BT_ENABLED */
@@ -0,0 +1,60 @@
+/*
+ * BLEClientPool.h
+ *
+ *  Created on: Oct 19, 2026
+ */
+
+#ifndef COMPONENTS_CPP_UTILS_BLECLIENTPOOL_H_
+#define COMPONENTS_CPP_UTILS_BLECLIENTPOOL_H_
+#include "sdkconfig.h"
+#if defined(CONFIG_BT_ENABLED)
+#include <list>
+#include "BLEAddress.h"
+#include "FreeRTOS.h"
+
+class BLEClient;
+
+/**
+ * @brief A pool of connected clients, kept open between uses.
+ *
+ * Connecting to a server and discovering its services takes far longer than reading a characteristic.  A
+ * client taken from the pool with acquire() stays connected when it is released, together with the services
+ * it has discovered, so the next acquire() of the same server costs nothing and a read on it is a single ATT
+ * round trip.  When more servers are in use than the pool may keep, the least recently used idle client is
+ * disconnected.  A client whose connection has dropped is discarded and a new one connected on the next
+ * acquire().
+ *
+ * BLEDevice::getValue() and BLEDevice::setValue() use a pool once BLEDevice::setClientPoolSize() is called.
+ */
+class BLEClientPool {
+public:
+	BLEClientPool(uint8_t maxClients);
+	~BLEClientPool();
+
+	BLEClient* acquire(BLEAddress address);
+	void       clear();
+	uint8_t    getMaxClients();
+	void       release(BLEClient* pClient);
+	void       setMaxClients(uint8_t maxClients);
+
+private:
+	struct Entry {
+		BLEClient* pClient;
+		BLEAddress address;      // The server the client is (or is being) connected to.
+		uint8_t    users;        // The callers that have acquired, and not yet released, the client.
+		bool       connecting;   // Reserved by an acquire() that is connecting it with the pool unlocked.
+	};
+
+	BLEClientPool(const BLEClientPool&) = delete;
+	BLEClientPool& operator=(const BLEClientPool&) = delete;
+
+	static void discard(BLEClient* pClient);
+	bool        trim(size_t maxClients);
+
+	std::list<Entry>    m_entries;   // Most recently used first.
+	uint8_t             m_maxClients;
+	FreeRTOS::Semaphore m_semaphorePool = FreeRTOS::Semaphore("ClientPool");
+}; // BLEClientPool
+
+#endif /* CONFIG_BT_ENABLED */
+#endif /* COMPONENTS_CPP_UTILS_BLECLIENTPOOL_H_ */
@@ -0,0 +1,299 @@
+/*
+ * BLEConnParamsPolicy.cpp
+ *
+ *  Created on: Oct 19, 2026
+ */
+#include "sdkconfig.h"
+#if defined(CONFIG_BT_ENABLED)
+#include <esp_log.h>
+#include <string.h>
+#include <vector>
+#include "BLEConnParamsPolicy.h"
+#include "BLEAddress.h"
+#include "GeneralUtils.h"
+#ifdef ARDUINO_ARCH_ESP32
+#include "esp32-hal-log.h"
+#endif
+
+static const char* LOG_TAG = "BLEConnParamsPolicy";
+
+static const uint32_t EVALUATE_PERIOD_MS = 500;
+
+
+BLEConnParamsPolicy::BLEConnParamsPolicy() {
+	m_fastParams           = { 6, 12, 0, 400 };      // 7.5 - 15 ms, 4 s supervision timeout.
+	m_idleParams           = { 80, 160, 4, 600 };    // 100 - 200 ms, 6 s supervision timeout.
+	m_fastBytesPerSec      = 2000;
+	m_idleBytesPerSec      = 200;
+	m_idleTimeoutMs        = 5000;
+	m_minRequestIntervalMs = 2000;
+	m_timer                = nullptr;
+} // BLEConnParamsPolicy
+
+
+BLEConnParamsPolicy::~BLEConnParamsPolicy() {
+	if (m_timer != nullptr) {
+		::xTimerDelete(m_timer, portMAX_DELAY);
+	}
+} // ~BLEConnParamsPolicy
+
+
+/**
+ * @brief Decide whether any connection should change its parameters.
+ * Called periodically once started; it may also be called directly with a clock of the caller's choosing.
+ * @param [in] nowMs The current time in milliseconds.
+ */
+void BLEConnParamsPolicy::evaluate(uint32_t nowMs) {
+	struct Request {
+		esp_bd_addr_t bda;
+		Params        params;
+	};
+	std::vector<Request> requests;
+
+	m_semaphorePolicy.take("evaluate");
+	for (auto &entry : m_connections) {
+		Connection& connection = entry.second;
+		uint32_t elapsed = nowMs - connection.windowStart;
+		if (elapsed == 0) {
+			continue;
+		}
+		uint32_t rate = (uint32_t)((uint64_t)connection.bytes * 1000 / elapsed);
+		bool busy = connection.backlog || rate >= m_fastBytesPerSec;
+		if (busy || rate > m_idleBytesPerSec) {
+			connection.lastActive = nowMs;
+		}
+		connection.bytes       = 0;
+		connection.backlog     = false;
+		connection.windowStart = nowMs;
+
+		if (connection.requested && nowMs - connection.lastRequest < m_minRequestIntervalMs) {
+			continue;   // Rate limited.
+		}
+		Mode want = connection.mode;
+		if (busy) {
+			want = MODE_FAST;
+		} else if (nowMs - connection.lastActive >= m_idleTimeoutMs) {
+			want = MODE_IDLE;
+		}
+		if (want == connection.mode) {
+			continue;
+		}
+		ESP_LOGD(LOG_TAG, "connId=%d: rate=%d bytes/s, requesting %s parameters", entry.first, rate,
+			want == MODE_FAST ? "fast" : "idle");
+		connection.mode        = want;
+		connection.requested   = true;
+		connection.lastRequest = nowMs;
+		Request request;
+		memcpy(request.bda, connection.bda, sizeof(esp_bd_addr_t));
+		request.params = (want == MODE_FAST) ? m_fastParams : m_idleParams;
+		requests.push_back(request);
+	}
+	m_semaphorePolicy.give();
+
+	for (auto &request : requests) {
+		requestParams(request.bda, request.params);
+	}
+} // evaluate
+
+
+/**
+ * @brief Determine whether a connection has been moved to the fast parameters.
+ * @param [in] connId The connection.
+ * @return True if the fast parameters were the last requested.
+ */
+bool BLEConnParamsPolicy::isFast(uint16_t connId) {
+	m_semaphorePolicy.take("isFast");
+	auto it = m_connections.find(connId);
+	bool fast = it != m_connections.end() && it->second.mode == MODE_FAST;
+	m_semaphorePolicy.give();
+	return fast;
+} // isFast
+
+
+/**
+ * @brief Note that data for a connection is backing up.
+ * The connection is moved to the fast parameters at the next evaluation, whatever its throughput.
+ * @param [in] connId The connection.
+ */
+void BLEConnParamsPolicy::onBacklog(uint16_t connId) {
+	m_semaphorePolicy.take("onBacklog");
+	auto it = m_connections.find(connId);
+	if (it != m_connections.end()) {
+		it->second.backlog = true;
+	}
+	m_semaphorePolicy.give();
+} // onBacklog
+
+
+/**
+ * @brief Start watching a connection.
+ * The parameters of a new connection are those chosen by the client, so nothing is requested until the
+ * connection is busy or has been idle for the idle timeout.
+ * @param [in] connId The connection.
+ * @param [in] remoteBda The address of the client.
+ */
+void BLEConnParamsPolicy::onConnect(uint16_t connId, esp_bd_addr_t remoteBda) {
+	uint32_t now = FreeRTOS::getTimeSinceStart();
+	Connection connection;
+	memcpy(connection.bda, remoteBda, sizeof(esp_bd_addr_t));
+	connection.mode        = MODE_UNKNOWN;
+	connection.bytes       = 0;
+	connection.backlog     = false;
+	connection.windowStart = now;
+	connection.lastActive  = now;
+	connection.lastRequest = 0;
+	connection.requested   = false;
+
+	m_semaphorePolicy.take("onConnect");
+	m_connections[connId] = connection;
+	m_semaphorePolicy.give();
+} // onConnect
+
+
+/**
+ * @brief Stop watching a connection.
+ * @param [in] connId The connection.
+ */
+void BLEConnParamsPolicy::onDisconnect(uint16_t connId) {
+	m_semaphorePolicy.take("onDisconnect");
+	m_connections.erase(connId);
+	m_semaphorePolicy.give();
+} // onDisconnect
+
+
+/**
+ * @brief Note the outcome of a request for new parameters.
+ * When a request is rejected the connection is marked as having unknown parameters, so the policy asks
+ * again once the minimum request interval has passed.
+ * @param [in] remoteBda The address of the client.
+ * @param [in] status The outcome of the update.
+ * @param [in] interval The connection interval now in use, in units of 1.25 ms.
+ */
+void BLEConnParamsPolicy::onParamsUpdated(esp_bd_addr_t remoteBda, esp_bt_status_t status, uint16_t interval) {
+	ESP_LOGD(LOG_TAG, "Parameters updated: address=%s, status=%d, interval=%d",
+		BLEAddress(remoteBda).toString().c_str(), status, interval);
+	if (status == ESP_BT_STATUS_SUCCESS) {
+		return;
+	}
+	m_semaphorePolicy.take("onParamsUpdated");
+	for (auto &entry : m_connections) {
+		if (memcmp(entry.second.bda, remoteBda, sizeof(esp_bd_addr_t)) == 0) {
+			entry.second.mode = MODE_UNKNOWN;
+		}
+	}
+	m_semaphorePolicy.give();
+} // onParamsUpdated
+
+
+/**
+ * @brief Count data sent or received on a connection.
+ * @param [in] connId The connection.
+ * @param [in] length The number of bytes.
+ */
+void BLEConnParamsPolicy::onTraffic(uint16_t connId, size_t length) {
+	m_semaphorePolicy.take("onTraffic");
+	auto it = m_connections.find(connId);
+	if (it != m_connections.end()) {
+		it->second.bytes += length;
+	}
+	m_semaphorePolicy.give();
+} // onTraffic
+
+
+/**
+ * @brief Ask the client for new connection parameters.
+ * @param [in] remoteBda The address of the client.
+ * @param [in] params The parameters to ask for.
+ */
+void BLEConnParamsPolicy::requestParams(esp_bd_addr_t remoteBda, const Params& params) {
+	esp_ble_conn_update_params_t conn_params;
+	memcpy(conn_params.bda, remoteBda, sizeof(esp_bd_addr_t));
+	conn_params.min_int = params.minInterval;
+	conn_params.max_int = params.maxInterval;
+	conn_params.latency = params.latency;
+	conn_params.timeout = params.timeout;
+	esp_err_t errRc = ::esp_ble_gap_update_conn_params(&conn_params);
+	if (errRc != ESP_OK) {
+		ESP_LOGE(LOG_TAG, "esp_ble_gap_update_conn_params: rc=%d %s", errRc, GeneralUtils::errorToString(errRc));
+	}
+} // requestParams
+
+
+/**
+ * @brief Set the parameters requested for a busy connection.
+ * @param [in] params The parameters.
+ */
+void BLEConnParamsPolicy::setFastParams(Params params) {
+	m_fastParams = params;
+} // setFastParams
+
+
+/**
+ * @brief Set the parameters requested for an idle connection.
+ * @param [in] params The parameters.
+ */
+void BLEConnParamsPolicy::setIdleParams(Params params) {
+	m_idleParams = params;
+} // setIdleParams
+
+
+/**
+ * @brief Set the shortest time between two requests on the same connection.
+ * @param [in] ms The minimum interval in milliseconds.
+ */
+void BLEConnParamsPolicy::setMinRequestInterval(uint32_t ms) {
+	m_minRequestIntervalMs = ms;
+} // setMinRequestInterval
+
+
+/**
+ * @brief Set the thresholds that switch between the fast and idle parameters.
+ * @param [in] fastBytesPerSec Throughput at or above which a connection is made fast.
+ * @param [in] idleBytesPerSec Throughput at or below which a connection counts as quiet.
+ * @param [in] idleTimeoutMs How long a connection must be quiet before it is made idle.
+ */
+void BLEConnParamsPolicy::setThresholds(uint32_t fastBytesPerSec, uint32_t idleBytesPerSec, uint32_t idleTimeoutMs) {
+	if (idleBytesPerSec >= fastBytesPerSec) {
+		ESP_LOGE(LOG_TAG, "Idle threshold %d must be below the fast threshold %d", idleBytesPerSec, fastBytesPerSec);
+		return;
+	}
+	m_fastBytesPerSec = fastBytesPerSec;
+	m_idleBytesPerSec = idleBytesPerSec;
+	m_idleTimeoutMs   = idleTimeoutMs;
+} // setThresholds
+
+
+/**
+ * @brief Start evaluating the connections periodically.
+ */
+void BLEConnParamsPolicy::start() {
+	if (m_timer == nullptr) {
+		m_timer = ::xTimerCreate("connParams", EVALUATE_PERIOD_MS / portTICK_PERIOD_MS, pdTRUE, this, timerCallback);
+		if (m_timer == nullptr) {
+			ESP_LOGE(LOG_TAG, "Unable to create the evaluation timer");
+			return;
+		}
+	}
+	::xTimerStart(m_timer, 0);
+} // start
+
+
+/**
+ * @brief Stop evaluating the connections.
+ */
+void BLEConnParamsPolicy::stop() {
+	if (m_timer != nullptr) {
+		::xTimerStop(m_timer, 0);
+	}
+} // stop
+
+
+/**
+ * @brief Timer callback that evaluates the connections.
+ * @param [in] timer The timer that expired; its ID is the policy.
+ */
+void BLEConnParamsPolicy::timerCallback(TimerHandle_t timer) {
+	((BLEConnParamsPolicy*)::pvTimerGetTimerID(timer))->evaluate(FreeRTOS::getTimeSinceStart());
+} // timerCallback
+
+#endif /* CONFIG_BT_ENABLED */
@@ -0,0 +1,93 @@
+/*
+ * BLEConnParamsPolicy.h
+ *
+ *  Created on: Oct 19, 2026
+ */
+
+#ifndef COMPONENTS_CPP_UTILS_BLECONNPARAMSPOLICY_H_
+#define COMPONENTS_CPP_UTILS_BLECONNPARAMSPOLICY_H_
+#include "sdkconfig.h"
+#if defined(CONFIG_BT_ENABLED)
+#include <esp_gap_ble_api.h>
+#include <map>
+#include "FreeRTOS.h"
+#include <freertos/timers.h>
+
+/**
+ * @brief A policy that tunes the connection parameters of a server to its traffic.
+ *
+ * A connection that is moving data, or whose transmit queue has backed up, is asked to switch to the fast
+ * parameters.  Once it has been quiet for the idle timeout it is asked to switch back to the idle parameters,
+ * which save power.  The two throughput thresholds give hysteresis: traffic between them keeps a fast
+ * connection fast without making an idle one fast.  Requests on a connection are never closer together than
+ * the minimum request interval, so a bursty link does not flap between the two.
+ *
+ * The policy is driven by BLEServer once installed with BLEServer::setConnParamsPolicy().  The requests go
+ * through requestParams(), which a subclass may override, and time is passed to evaluate(), so the decisions
+ * can be exercised without a radio.
+ */
+class BLEConnParamsPolicy {
+public:
+	/**
+	 * @brief A set of connection parameters.
+	 * Intervals are in units of 1.25 ms and the supervision timeout is in units of 10 ms.
+	 */
+	struct Params {
+		uint16_t minInterval;
+		uint16_t maxInterval;
+		uint16_t latency;
+		uint16_t timeout;
+	};
+
+	BLEConnParamsPolicy();
+	virtual ~BLEConnParamsPolicy();
+
+	void evaluate(uint32_t nowMs);
+	bool isFast(uint16_t connId);
+	void onBacklog(uint16_t connId);
+	void onConnect(uint16_t connId, esp_bd_addr_t remoteBda);
+	void onDisconnect(uint16_t connId);
+	void onParamsUpdated(esp_bd_addr_t remoteBda, esp_bt_status_t status, uint16_t interval);
+	void onTraffic(uint16_t connId, size_t length);
+	void setFastParams(Params params);
+	void setIdleParams(Params params);
+	void setMinRequestInterval(uint32_t ms);
+	void setThresholds(uint32_t fastBytesPerSec, uint32_t idleBytesPerSec, uint32_t idleTimeoutMs);
+	void start();
+	void stop();
+
+protected:
+	virtual void requestParams(esp_bd_addr_t remoteBda, const Params& params);
+
+private:
+	enum Mode { MODE_UNKNOWN, MODE_IDLE, MODE_FAST };
+
+	struct Connection {
+		esp_bd_addr_t bda;
+		Mode          mode;
+		uint32_t      bytes;           // Traffic since the last evaluation.
+		bool          backlog;         // The transmit queue backed up since the last evaluation.
+		uint32_t      windowStart;     // When the current traffic window began.
+		uint32_t      lastActive;      // When the traffic was last above the idle threshold.
+		uint32_t      lastRequest;     // When parameters were last requested.
+		bool          requested;       // A request has been made on this connection.
+	};
+
+	BLEConnParamsPolicy(const BLEConnParamsPolicy&) = delete;
+	BLEConnParamsPolicy& operator=(const BLEConnParamsPolicy&) = delete;
+
+	static void timerCallback(TimerHandle_t timer);
+
+	std::map<uint16_t, Connection> m_connections;
+	Params                         m_fastParams;
+	Params                         m_idleParams;
+	uint32_t                       m_fastBytesPerSec;
+	uint32_t                       m_idleBytesPerSec;
+	uint32_t                       m_idleTimeoutMs;
+	uint32_t                       m_minRequestIntervalMs;
+	TimerHandle_t                  m_timer;
+	FreeRTOS::Semaphore            m_semaphorePolicy = FreeRTOS::Semaphore("ConnParamsPolicy");
+}; // BLEConnParamsPolicy
+
+#endif /* CONFIG_BT_ENABLED */
+#endif /* COMPONENTS_CPP_UTILS_BLECONNPARAMSPOLICY_H_ */
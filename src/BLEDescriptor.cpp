@@ -37,9 +37,10 @@ BLEDescriptor::BLEDescriptor(const char* uuid) : BLEDescriptor(BLEUUID(uuid)) {
  */
 BLEDescriptor::BLEDescriptor(BLEUUID uuid) {
 	m_bleUUID            = uuid;
-	m_value.attr_value   = (uint8_t *)malloc(ESP_GATT_MAX_ATTR_LEN);  // Allocate storage for the value.
+	m_value.attr_value   = nullptr;                                   // Storage is allocated when a value is set.
 	m_value.attr_len     = 0;                                         // Initial length is 0.
 	m_value.attr_max_len = ESP_GATT_MAX_ATTR_LEN;                     // Maximum length of the data.
+	m_valueCapacity      = 0;
 	m_handle             = NULL_HANDLE;                               // Handle is initially unknown.
 	m_pCharacteristic    = nullptr;                                   // No initial characteristic.
 	m_pCallback          = nullptr;                                   // No initial callback.
@@ -71,7 +72,7 @@ void BLEDescriptor::executeCreate(BLECharacteristic* pCharacteristic) {
 
 	esp_attr_control_t control;
 	control.auto_rsp = ESP_GATT_RSP_BY_APP;
-	m_semaphoreCreateEvt.take("executeCreate");
+	BLEServer::takeEventSemaphore(m_pCharacteristic->getService()->getServer(), m_semaphoreCreateEvt, ESP_GATTS_ADD_CHAR_DESCR_EVT, "executeCreate");
 	esp_err_t errRc = ::esp_ble_gatts_add_char_descr(
 			pCharacteristic->getService()->getHandle(),
 			getUUID().getNative(),
@@ -83,7 +84,7 @@ void BLEDescriptor::executeCreate(BLECharacteristic* pCharacteristic) {
 		return;
 	}
 
-	m_semaphoreCreateEvt.wait("executeCreate");
+	BLEServer::eventSemaphore(m_pCharacteristic->getService()->getServer(), m_semaphoreCreateEvt).wait("executeCreate");
 	ESP_LOGD(LOG_TAG, "<< executeCreate");
 } // executeCreate
 
@@ -106,6 +107,15 @@ size_t BLEDescriptor::getLength() {
 } // getLength
 
 
+/**
+ * @brief Get the RAM used by the descriptor.
+ * @return The size of the descriptor object plus the heap it owns.
+ */
+size_t BLEDescriptor::getMemoryUsage() {
+	return sizeof(BLEDescriptor) + m_valueCapacity + m_semaphoreCreateEvt.getHeapSize();
+} // getMemoryUsage
+
+
 /**
  * @brief Get the UUID of the descriptor.
  */
@@ -114,10 +124,11 @@ BLEUUID BLEDescriptor::getUUID() {
 } // getUUID
 
 
-
 /**
  * @brief Get the value of this descriptor.
- * @return A pointer to the value of this descriptor.
+ * The storage for the value is only allocated when a value is set, so a descriptor that has never been
+ * given a value has no buffer.  Only the first getLength() bytes may be accessed.
+ * @return A pointer to the value of this descriptor or nullptr if no value has been set.
  */
 uint8_t* BLEDescriptor::getValue() {
 	return m_value.attr_value;
@@ -159,7 +170,7 @@ void BLEDescriptor::handleGATTServerEvent(
 					m_pCharacteristic->getService()->getHandle() == param->add_char_descr.service_handle &&
 					m_pCharacteristic == m_pCharacteristic->getService()->getLastCreatedCharacteristic()) {
 				setHandle(param->add_char_descr.attr_handle);
-				m_semaphoreCreateEvt.give();
+				BLEServer::giveEventSemaphore(m_pCharacteristic->getService()->getServer(), m_semaphoreCreateEvt, ESP_GATTS_ADD_CHAR_DESCR_EVT);
 			}
 			break;
 		} // ESP_GATTS_ADD_CHAR_DESCR_EVT
@@ -185,7 +196,9 @@ void BLEDescriptor::handleGATTServerEvent(
 				rsp.attr_value.handle = m_handle;
 				rsp.attr_value.offset = 0;
 				rsp.attr_value.auth_req = ESP_GATT_AUTH_REQ_NONE;
-				memcpy(rsp.attr_value.value, getValue(), rsp.attr_value.len);
+				if (rsp.attr_value.len > 0) {   // A descriptor without a value has no storage to copy from.
+					memcpy(rsp.attr_value.value, getValue(), rsp.attr_value.len);
+				}
 				esp_err_t errRc = ::esp_ble_gatts_send_response(
 						gatts_if,
 						param->write.conn_id,
@@ -230,7 +243,9 @@ void BLEDescriptor::handleGATTServerEvent(
 					rsp.attr_value.handle   = param->read.handle;
 					rsp.attr_value.offset   = 0;
 					rsp.attr_value.auth_req = ESP_GATT_AUTH_REQ_NONE;
-					memcpy(rsp.attr_value.value, getValue(), rsp.attr_value.len);
+					if (rsp.attr_value.len > 0) {   // A descriptor without a value has no storage to copy from.
+						memcpy(rsp.attr_value.value, getValue(), rsp.attr_value.len);
+					}
 
 					esp_err_t errRc = ::esp_ble_gatts_send_response(
 							gatts_if,
@@ -288,6 +303,15 @@ void BLEDescriptor::setValue(uint8_t* data, size_t length) {
 		ESP_LOGE(LOG_TAG, "Size %d too large, must be no bigger than %d", length, ESP_GATT_MAX_ATTR_LEN);
 		return;
 	}
+	if (length > m_valueCapacity) {   // Most descriptors hold a few bytes; only grow the storage when needed.
+		uint8_t* pNew = (uint8_t*)realloc(m_value.attr_value, length);
+		if (pNew == nullptr) {
+			ESP_LOGE(LOG_TAG, "Unable to allocate %d bytes for the descriptor value", length);
+			return;
+		}
+		m_value.attr_value = pNew;
+		m_valueCapacity    = length;
+	}
 	m_value.attr_len = length;
 	memcpy(m_value.attr_value, data, length);
 } // setValue
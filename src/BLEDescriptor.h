@@ -30,8 +30,9 @@ public:
 
 	uint16_t getHandle();                                   // Get the handle of the descriptor.
 	size_t   getLength();                                   // Get the length of the value of the descriptor.
+	size_t   getMemoryUsage();                              // Get the RAM used by the descriptor.
 	BLEUUID  getUUID();                                     // Get the UUID of the descriptor.
-	uint8_t* getValue();                                    // Get a pointer to the value of the descriptor.
+	uint8_t* getValue();                                    // Get a pointer to the value of the descriptor, nullptr if none set.
 	void handleGATTServerEvent(
 			esp_gatts_cb_event_t      event,
 			esp_gatt_if_t             gatts_if,
@@ -47,6 +48,7 @@ public:
 private:
 	friend class BLEDescriptorMap;
 	friend class BLECharacteristic;
+	friend class BLEService;
 	BLEUUID                 m_bleUUID;
 	uint16_t                m_handle;
 	BLEDescriptorCallbacks* m_pCallback;
@@ -54,6 +56,7 @@ private:
 	esp_gatt_perm_t				  m_permissions = ESP_GATT_PERM_READ | ESP_GATT_PERM_WRITE;
 	FreeRTOS::Semaphore     m_semaphoreCreateEvt = FreeRTOS::Semaphore("CreateEvt");
 	esp_attr_value_t        m_value;
+	uint16_t                m_valueCapacity;   // The size of the m_value.attr_value buffer, grown as needed.
 
 	void executeCreate(BLECharacteristic* pCharacteristic);
 	void setHandle(uint16_t handle);
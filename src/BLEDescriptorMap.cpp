@@ -15,6 +15,8 @@
 #include "esp32-hal-log.h"
 #endif
 
+static const size_t MAP_NODE_OVERHEAD = 4 * sizeof(void*);   // Colour and links of a std::map node.
+
 /**
  * @brief Return the descriptor by UUID.
  * @param [in] UUID The UUID to look up the descriptor.
@@ -149,4 +151,17 @@ BLEDescriptor* BLEDescriptorMap::getNext() {
 	m_iterator++;
 	return pRet;
 } // getNext
+
+
+/**
+ * @brief Get the heap used by the map itself.
+ * @return The size of the map nodes and keys, not including the descriptors.
+ */
+size_t BLEDescriptorMap::getMemoryUsage() {
+	size_t size = m_handleMap.size() * (MAP_NODE_OVERHEAD + sizeof(std::pair<const uint16_t, BLEDescriptor*>));
+	for (auto &myPair : m_uuidMap) {
+		size += MAP_NODE_OVERHEAD + sizeof(myPair) + myPair.first.capacity();
+	}
+	return size;
+} // getMemoryUsage
 #endif /* CONFIG_BT_ENABLED */
@@ -40,15 +40,24 @@ static const char* LOG_TAG = "BLEDevice";
  */
 BLEServer* BLEDevice::m_pServer = nullptr;
 BLEScan*   BLEDevice::m_pScan   = nullptr;
-BLEClient* BLEDevice::m_pClient = nullptr;
+BLEClientPool* BLEDevice::m_pClientPool = nullptr;
+BLEClient* BLEDevice::m_clients[BLE_MAX_CLIENTS] = { nullptr };
+std::map<esp_gatt_if_t, BLEClient*> BLEDevice::m_clientsByGattcIf;
 bool       initialized          = false;   // Have we been initialized?
 esp_ble_sec_act_t 	BLEDevice::m_securityLevel = (esp_ble_sec_act_t)0;
 BLESecurityCallbacks* BLEDevice::m_securityCallbacks = nullptr;
 uint16_t   BLEDevice::m_localMTU = 23;
+uint16_t   BLEDevice::m_dataLength = 251;
+std::deque<std::string> BLEDevice::m_dataLengthPending;
+std::map<std::string, esp_ble_pkt_data_length_params_t> BLEDevice::m_dataLengths;
+static FreeRTOS::Semaphore dataLengthSemaphore = FreeRTOS::Semaphore("DataLength");
+static FreeRTOS::Semaphore clientsSemaphore    = FreeRTOS::Semaphore("Clients");
 
 /**
  * @brief Create a new instance of a client.
- * @return A new instance of the client.
+ * Each client holds one connection, so several clients may be connected to different servers at the same
+ * time.  At most BLE_MAX_CLIENTS clients can exist at once; delete a client to free its place.
+ * @return A new instance of the client or nullptr if BLE_MAX_CLIENTS clients already exist.
  */
 /* STATIC */ BLEClient* BLEDevice::createClient() {
 	ESP_LOGD(LOG_TAG, ">> createClient");
@@ -56,12 +65,61 @@ uint16_t   BLEDevice::m_localMTU = 23;
 	ESP_LOGE(LOG_TAG, "BLE GATTC is not enabled - CONFIG_GATTC_ENABLE not defined");
 	abort();
 #endif  // CONFIG_GATTC_ENABLE
-	m_pClient = new BLEClient();
-	ESP_LOGD(LOG_TAG, "<< createClient");
-	return m_pClient;
+	BLEClient* pClient = nullptr;
+	clientsSemaphore.take("createClient");
+	for (uint16_t appId = 0; appId < BLE_MAX_CLIENTS; appId++) {
+		if (m_clients[appId] == nullptr) {
+			pClient = new BLEClient();
+			pClient->m_appId = appId;
+			m_clients[appId] = pClient;
+			break;
+		}
+	}
+	clientsSemaphore.give();
+	if (pClient == nullptr) {
+		ESP_LOGE(LOG_TAG, "<< createClient: all %d clients are in use", BLE_MAX_CLIENTS);
+		return nullptr;
+	}
+	ESP_LOGD(LOG_TAG, "<< createClient: appId=%d", pClient->m_appId);
+	return pClient;
 } // createClient
 
 
+/**
+ * @brief Close the connection of a client, unregister its app and delete it once the stack is done with it.
+ * The close and the unregistration are carried out by the %BLE task, which may meanwhile still be dispatching
+ * events to the client (CLOSE, DISCONNECT).  The client is therefore deleted on that task, once
+ * ESP_GATTC_UNREG_EVT, the last event of its app, has been handled.
+ * @param [in] pClient The client, which must not be used again.
+ */
+/* STATIC */ void BLEDevice::deleteClient(BLEClient* pClient) {
+	clientsSemaphore.take("deleteClient");
+	auto it = m_clientsByGattcIf.find(pClient->m_gattc_if);
+	bool registered = it != m_clientsByGattcIf.end() && it->second == pClient;
+	if (registered) {
+		pClient->m_deleteOnUnregister = true;
+	}
+	clientsSemaphore.give();
+	if (!registered) {
+		delete pClient;   // No app, so no events to wait for.
+		return;
+	}
+
+	if (pClient->isConnected()) {
+		esp_err_t errRc = ::esp_ble_gattc_close(pClient->getGattcIf(), pClient->getConnId());
+		if (errRc != ESP_OK) {
+			ESP_LOGE(LOG_TAG, "esp_ble_gattc_close: rc=%d %s", errRc, GeneralUtils::errorToString(errRc));
+		}
+	}
+	esp_err_t errRc = ::esp_ble_gattc_app_unregister(pClient->getGattcIf());
+	if (errRc != ESP_OK) {
+		ESP_LOGE(LOG_TAG, "esp_ble_gattc_app_unregister: rc=%d %s", errRc, GeneralUtils::errorToString(errRc));
+		removeClient(pClient);   // No ESP_GATTC_UNREG_EVT will come; stop dispatching to the client before deleting it.
+		delete pClient;
+	}
+} // deleteClient
+
+
 /**
  * @brief Create a new instance of a server.
  * @return A new instance of the server.
@@ -100,6 +158,7 @@ uint16_t   BLEDevice::m_localMTU = 23;
 	switch(event) {
 		case ESP_GATTS_CONNECT_EVT: {
 			BLEDevice::m_localMTU = 23;
+			requestDataLength(param->connect.remote_bda);
 #ifdef CONFIG_BLE_SMP_ENABLE   // Check that BLE SMP (security) is configured in make menuconfig
 			if(BLEDevice::m_securityLevel){
 				esp_ble_set_encryption(param->connect.remote_bda, BLEDevice::m_securityLevel);
@@ -108,6 +167,11 @@ uint16_t   BLEDevice::m_localMTU = 23;
 			break;
 		} // ESP_GATTS_CONNECT_EVT
 
+		case ESP_GATTS_DISCONNECT_EVT: {
+			forgetDataLength(param->disconnect.remote_bda);
+			break;
+		} // ESP_GATTS_DISCONNECT_EVT
+
 		case ESP_GATTS_MTU_EVT: {
 			BLEDevice::m_localMTU = param->mtu.mtu;
 	        ESP_LOGI(LOG_TAG, "ESP_GATTS_MTU_EVT, MTU %d", BLEDevice::m_localMTU);
@@ -143,14 +207,39 @@ uint16_t   BLEDevice::m_localMTU = 23;
 		gattc_if, BLEUtils::gattClientEventTypeToString(event).c_str());
 	BLEUtils::dumpGattClientEvent(event, gattc_if, param);
 
+	// Find the client the event is for.  A client's interface is not known until its app is registered, so
+	// the registration is matched on the app id the client registered with.
+	BLEClient* pClient = nullptr;
+	if (event == ESP_GATTC_REG_EVT) {
+		clientsSemaphore.take("gattClientEventHandler");
+		if (param->reg.app_id < BLE_MAX_CLIENTS) {
+			pClient = m_clients[param->reg.app_id];
+		}
+		if (pClient != nullptr && param->reg.status == ESP_GATT_OK) {
+			auto it = m_clientsByGattcIf.find(pClient->m_gattc_if);
+			if (it != m_clientsByGattcIf.end() && it->second == pClient) {
+				m_clientsByGattcIf.erase(it);   // The interface of an earlier registration.
+			}
+			m_clientsByGattcIf[gattc_if] = pClient;
+		}
+		clientsSemaphore.give();
+	} else {
+		pClient = getClient(gattc_if);
+	}
+
 	switch(event) {
 		case ESP_GATTC_CONNECT_EVT: {
+			// Every registered app is told of every connection; act only for the client that opened it.
+			if (pClient == nullptr || !pClient->getPeerAddress().equals(BLEAddress(param->connect.remote_bda))) {
+				break;
+			}
 			if(BLEDevice::getMTU() != 23){
 				esp_err_t errRc = esp_ble_gattc_send_mtu_req(gattc_if, param->connect.conn_id);
 				if (errRc != ESP_OK) {
 					ESP_LOGE(LOG_TAG, "esp_ble_gattc_send_mtu_req: rc=%d %s", errRc, GeneralUtils::errorToString(errRc));
 				}
 			}
+			requestDataLength(param->connect.remote_bda);
 #ifdef CONFIG_BLE_SMP_ENABLE   // Check that BLE SMP (security) is configured in make menuconfig
 			if(BLEDevice::m_securityLevel){
 				esp_ble_set_encryption(param->connect.remote_bda, BLEDevice::m_securityLevel);
@@ -159,15 +248,33 @@ uint16_t   BLEDevice::m_localMTU = 23;
 			break;
 		} // ESP_GATTC_CONNECT_EVT
 
+		case ESP_GATTC_DISCONNECT_EVT: {
+			forgetDataLength(param->disconnect.remote_bda);
+			break;
+		} // ESP_GATTC_DISCONNECT_EVT
+
 		default: {
 			break;
 		}
 	} // switch
 
 
-	// If we have a client registered, call it.
-	if (BLEDevice::m_pClient != nullptr) {
-		BLEDevice::m_pClient->gattClientEventHandler(event, gattc_if, param);
+	// Pass the event to its client.  Events not tied to an app go to every client.
+	if (pClient != nullptr) {
+		pClient->gattClientEventHandler(event, gattc_if, param);
+		if (event == ESP_GATTC_UNREG_EVT && pClient->m_deleteOnUnregister) {
+			delete pClient;   // The last event of its app; see deleteClient().
+		}
+	} else if (gattc_if == ESP_GATT_IF_NONE) {
+		BLEClient* clients[BLE_MAX_CLIENTS];
+		clientsSemaphore.take("gattClientEventHandler");
+		memcpy(clients, m_clients, sizeof(clients));
+		clientsSemaphore.give();
+		for (int i = 0; i < BLE_MAX_CLIENTS; i++) {
+			if (clients[i] != nullptr) {
+				clients[i]->gattClientEventHandler(event, gattc_if, param);
+			}
+		}
 	}
 
 } // gattClientEventHandler
@@ -184,6 +291,24 @@ uint16_t   BLEDevice::m_localMTU = 23;
 
 	switch(event) {
 
+		 case ESP_GAP_BLE_SET_PKT_LENGTH_COMPLETE_EVT: {
+			// The event does not say which connection it is for; requests complete in the order they were made.
+			dataLengthSemaphore.take("pktLengthComplete");
+			if (!m_dataLengthPending.empty()) {
+				std::string address = m_dataLengthPending.front();
+				m_dataLengthPending.pop_front();
+				if (param->pkt_data_lenth_cmpl.status == ESP_BT_STATUS_SUCCESS) {
+					m_dataLengths[address] = param->pkt_data_lenth_cmpl.params;
+					ESP_LOGI(LOG_TAG, "Data length for %s: tx=%d, rx=%d", address.c_str(),
+						param->pkt_data_lenth_cmpl.params.tx_len, param->pkt_data_lenth_cmpl.params.rx_len);
+				} else {
+					ESP_LOGW(LOG_TAG, "Data length for %s not extended: status=%d", address.c_str(), param->pkt_data_lenth_cmpl.status);
+				}
+			}
+			dataLengthSemaphore.give();
+			break;
+		 } // ESP_GAP_BLE_SET_PKT_LENGTH_COMPLETE_EVT
+
 		 case ESP_GAP_BLE_OOB_REQ_EVT:                                /* OOB request event */
 			 ESP_LOGI(LOG_TAG, "ESP_GAP_BLE_OOB_REQ_EVT");
 			 break;
@@ -263,8 +388,14 @@ uint16_t   BLEDevice::m_localMTU = 23;
 		BLEDevice::m_pServer->handleGAPEvent(event, param);
 	}
 
-	if (BLEDevice::m_pClient != nullptr) {
-		BLEDevice::m_pClient->handleGAPEvent(event, param);
+	BLEClient* clients[BLE_MAX_CLIENTS];
+	clientsSemaphore.take("gapEventHandler");
+	memcpy(clients, BLEDevice::m_clients, sizeof(clients));
+	clientsSemaphore.give();
+	for (int i = 0; i < BLE_MAX_CLIENTS; i++) {
+		if (clients[i] != nullptr) {
+			clients[i]->handleGAPEvent(event, param);
+		}
 	}
 
 	if (BLEDevice::m_pScan != nullptr) {
@@ -291,6 +422,37 @@ uint16_t   BLEDevice::m_localMTU = 23;
 } // getAddress
 
 
+/**
+ * @brief Get the client whose app is registered on a GATT client interface.
+ * @param [in] gattc_if The interface.
+ * @return The client or nullptr if there is none.
+ */
+/* STATIC */ BLEClient* BLEDevice::getClient(esp_gatt_if_t gattc_if) {
+	clientsSemaphore.take("getClient");
+	auto it = m_clientsByGattcIf.find(gattc_if);
+	BLEClient* pClient = (it == m_clientsByGattcIf.end()) ? nullptr : it->second;
+	clientsSemaphore.give();
+	return pClient;
+} // getClient
+
+
+/**
+ * @brief Get the number of clients that exist.
+ * @return The number of clients, at most BLE_MAX_CLIENTS.
+ */
+/* STATIC */ int BLEDevice::getClientCount() {
+	int count = 0;
+	clientsSemaphore.take("getClientCount");
+	for (int i = 0; i < BLE_MAX_CLIENTS; i++) {
+		if (m_clients[i] != nullptr) {
+			count++;
+		}
+	}
+	clientsSemaphore.give();
+	return count;
+} // getClientCount
+
+
 /**
  * @brief Retrieve the Scan object that we use for scanning.
  * @return The scanning object reference.  This is a singleton object.  The caller should not
@@ -315,10 +477,32 @@ uint16_t   BLEDevice::m_localMTU = 23;
  */
 /* STATIC */ std::string BLEDevice::getValue(BLEAddress bdAddress, BLEUUID serviceUUID, BLEUUID characteristicUUID) {
 	ESP_LOGD(LOG_TAG, ">> getValue: bdAddress: %s, serviceUUID: %s, characteristicUUID: %s", bdAddress.toString().c_str(), serviceUUID.toString().c_str(), characteristicUUID.toString().c_str());
+	if (m_pClientPool != nullptr) {
+		BLEClient* pClient = m_pClientPool->acquire(bdAddress);
+		if (pClient == nullptr) {
+			return "";
+		}
+		std::string ret;
+		try {
+			ret = pClient->getValue(serviceUUID, characteristicUUID);
+		} catch (...) {
+			m_pClientPool->release(pClient);
+			throw;
+		}
+		m_pClientPool->release(pClient);
+		ESP_LOGD(LOG_TAG, "<< getValue");
+		return ret;
+	}
 	BLEClient *pClient = createClient();
-	pClient->connect(bdAddress);
+	if (pClient == nullptr) {
+		return "";
+	}
+	if (!pClient->connect(bdAddress)) {
+		deleteClient(pClient);
+		return "";
+	}
 	std::string ret = pClient->getValue(serviceUUID, characteristicUUID);
-	pClient->disconnect();
+	deleteClient(pClient);
 	ESP_LOGD(LOG_TAG, "<< getValue");
 	return ret;
 } // getValue
@@ -433,6 +617,49 @@ uint16_t   BLEDevice::m_localMTU = 23;
 } // init
 
 
+/**
+ * @brief Forget a client that is being deleted, freeing its place for a new client.
+ * Events that arrive for it afterwards are dropped.
+ * @param [in] pClient The client.
+ */
+/* STATIC */ void BLEDevice::removeClient(BLEClient* pClient) {
+	clientsSemaphore.take("removeClient");
+	if (pClient->m_appId < BLE_MAX_CLIENTS && m_clients[pClient->m_appId] == pClient) {
+		m_clients[pClient->m_appId] = nullptr;
+	}
+	auto it = m_clientsByGattcIf.find(pClient->m_gattc_if);
+	if (it != m_clientsByGattcIf.end() && it->second == pClient) {
+		m_clientsByGattcIf.erase(it);
+	}
+	clientsSemaphore.give();
+} // removeClient
+
+
+/**
+ * @brief Keep the connections made by getValue() and setValue() open for reuse.
+ * Up to maxClients idle connections are kept, with the services discovered on them, so a repeated
+ * getValue() of the same server is a single read.  When more servers are used, the least recently used
+ * connection is closed.  Each kept connection holds one of the BLE_MAX_CLIENTS clients.  Call this while no
+ * getValue() or setValue() is running.
+ * @param [in] maxClients The most connections to keep, or 0 to connect and disconnect on every call.
+ */
+/* STATIC */ void BLEDevice::setClientPoolSize(uint8_t maxClients) {
+	ESP_LOGD(LOG_TAG, ">> setClientPoolSize: %d", maxClients);
+	if (maxClients > BLE_MAX_CLIENTS) {
+		maxClients = BLE_MAX_CLIENTS;
+	}
+	if (maxClients == 0) {
+		delete m_pClientPool;   // Disconnects the pooled clients.
+		m_pClientPool = nullptr;
+	} else if (m_pClientPool == nullptr) {
+		m_pClientPool = new BLEClientPool(maxClients);
+	} else {
+		m_pClientPool->setMaxClients(maxClients);
+	}
+	ESP_LOGD(LOG_TAG, "<< setClientPoolSize");
+} // setClientPoolSize
+
+
 /**
  * @brief Set the transmission power.
  * The power level can be one of:
@@ -464,10 +691,30 @@ uint16_t   BLEDevice::m_localMTU = 23;
  */
 /* STATIC */ void BLEDevice::setValue(BLEAddress bdAddress, BLEUUID serviceUUID, BLEUUID characteristicUUID, std::string value) {
 	ESP_LOGD(LOG_TAG, ">> setValue: bdAddress: %s, serviceUUID: %s, characteristicUUID: %s", bdAddress.toString().c_str(), serviceUUID.toString().c_str(), characteristicUUID.toString().c_str());
+	if (m_pClientPool != nullptr) {
+		BLEClient* pClient = m_pClientPool->acquire(bdAddress);
+		if (pClient == nullptr) {
+			return;
+		}
+		try {
+			pClient->setValue(serviceUUID, characteristicUUID, value);
+		} catch (...) {
+			m_pClientPool->release(pClient);
+			throw;
+		}
+		m_pClientPool->release(pClient);
+		return;
+	}
 	BLEClient *pClient = createClient();
-	pClient->connect(bdAddress);
+	if (pClient == nullptr) {
+		return;
+	}
+	if (!pClient->connect(bdAddress)) {
+		deleteClient(pClient);
+		return;
+	}
 	pClient->setValue(serviceUUID, characteristicUUID, value);
-	pClient->disconnect();
+	deleteClient(pClient);
 } // setValue
 
 
@@ -548,6 +795,71 @@ uint16_t BLEDevice::getMTU() {
 	return m_localMTU;
 }
 
+/**
+ * @brief Get the link layer data length negotiated with a peer.
+ * @param [in] address The address of the peer.
+ * @return The number of octets in the payload of a link layer packet sent to the peer, 27 until Data Length Extension has been negotiated.
+ */
+uint16_t BLEDevice::getDataLength(BLEAddress address) {
+	uint16_t txLength = 27;
+	dataLengthSemaphore.take("getDataLength");
+	auto it = m_dataLengths.find(address.toString());
+	if (it != m_dataLengths.end()) {
+		txLength = it->second.tx_len;
+	}
+	dataLengthSemaphore.give();
+	return txLength;
+} // getDataLength
+
+
+/**
+ * @brief Set the link layer data length to ask for on each new connection.
+ *
+ * Without Data Length Extension a link layer packet carries at most 27 octets, however large the MTU, so a
+ * notification of 244 bytes takes ten packets.  With it the packet carries up to 251 octets.  The extension is
+ * requested as soon as a connection is made, as a server or as a client, and the outcome can be retrieved with
+ * getDataLength().
+ * @param [in] txOctets The data length to ask for, from 27 to 251, or 0 not to ask.
+ */
+void BLEDevice::setDataLength(uint16_t txOctets) {
+	if (txOctets != 0 && (txOctets < 27 || txOctets > 251)) {
+		ESP_LOGE(LOG_TAG, "Data length %d out of range, must be from 27 to 251", txOctets);
+		return;
+	}
+	m_dataLength = txOctets;
+} // setDataLength
+
+
+/**
+ * @brief Forget the data length negotiated with a peer that has disconnected.
+ * @param [in] address The address of the peer.
+ */
+void BLEDevice::forgetDataLength(esp_bd_addr_t address) {
+	dataLengthSemaphore.take("forgetDataLength");
+	m_dataLengths.erase(BLEAddress(address).toString());
+	dataLengthSemaphore.give();
+} // forgetDataLength
+
+
+/**
+ * @brief Ask the controller to use Data Length Extension on a new connection.
+ * @param [in] address The address of the peer.
+ */
+void BLEDevice::requestDataLength(esp_bd_addr_t address) {
+	if (m_dataLength == 0) {
+		return;
+	}
+	dataLengthSemaphore.take("requestDataLength");
+	esp_err_t errRc = ::esp_ble_gap_set_pkt_data_len(address, m_dataLength);
+	if (errRc == ESP_OK) {
+		m_dataLengthPending.push_back(BLEAddress(address).toString());
+	} else {
+		ESP_LOGE(LOG_TAG, "esp_ble_gap_set_pkt_data_len: rc=%d %s", errRc, GeneralUtils::errorToString(errRc));
+	}
+	dataLengthSemaphore.give();
+} // requestDataLength
+
+
 bool BLEDevice::getInitialized() {
 	return initialized;
 }
@@ -11,16 +11,30 @@
 #if defined(CONFIG_BT_ENABLED)
 #include <esp_gap_ble_api.h> // ESP32 BLE
 #include <esp_gattc_api.h>   // ESP32 BLE
+#include <deque>             // Part of C++ STL
 #include <map>               // Part of C++ STL
 #include <string>
 #include <esp_bt.h>
 
 #include "BLEServer.h"
 #include "BLEClient.h"
+#include "BLEClientPool.h"
 #include "BLEUtils.h"
 #include "BLEScan.h"
 #include "BLEAddress.h"
 
+/**
+ * The most clients that can exist at once: one for each connection the controller can hold.  A server's
+ * connections come from the same limit.
+ */
+#if defined(CONFIG_BTDM_CTRL_BLE_MAX_CONN)
+#define BLE_MAX_CLIENTS CONFIG_BTDM_CTRL_BLE_MAX_CONN
+#elif defined(CONFIG_BT_ACL_CONNECTIONS)
+#define BLE_MAX_CLIENTS CONFIG_BT_ACL_CONNECTIONS
+#else
+#define BLE_MAX_CLIENTS 4
+#endif
+
 /**
  * @brief %BLE functions.
  */
@@ -28,11 +42,13 @@ class BLEDevice {
 public:
 
 	static BLEClient*  createClient();    // Create a new BLE client.
+	static int         getClientCount();  // Get the number of clients that exist.
 	static BLEServer*  createServer();    // Cretae a new BLE server.
 	static BLEAddress  getAddress();      // Retrieve our own local BD address.
 	static BLEScan*    getScan();         // Get the scan object
 	static std::string getValue(BLEAddress bdAddress, BLEUUID serviceUUID, BLEUUID characteristicUUID);	  // Get the value of a characteristic of a service on a server.
 	static void        init(std::string deviceName);   // Initialize the local BLE environment.
+	static void        setClientPoolSize(uint8_t maxClients);   // Keep the connections of getValue() and setValue() open.
 	static void        setPower(esp_power_level_t powerLevel);  // Set our power level.
 	static void        setValue(BLEAddress bdAddress, BLEUUID serviceUUID, BLEUUID characteristicUUID, std::string value);   // Set the value of a characteristic on a service on a server.
 	static std::string toString();        // Return a string representation of our device.
@@ -42,15 +58,31 @@ public:
 	static void		   setSecurityCallbacks(BLESecurityCallbacks* pCallbacks);
 	static esp_err_t   setMTU(uint16_t mtu);
 	static uint16_t	   getMTU();
+	static uint16_t    getDataLength(BLEAddress address);
+	static void        setDataLength(uint16_t txOctets);
 	static bool        getInitialized(); // Returns the state of the device, is it initialized or not?
 
 private:
+	friend class BLEClient;
+	friend class BLEClientPool;
+
 	static BLEServer *m_pServer;
 	static BLEScan   *m_pScan;
-	static BLEClient *m_pClient;
+	static BLEClientPool *m_pClientPool;   // The connections of getValue() and setValue(), if pooled.
+	static BLEClient *m_clients[BLE_MAX_CLIENTS];   // The clients that exist, indexed by their GATT client app id.
+	static std::map<esp_gatt_if_t, BLEClient*> m_clientsByGattcIf;   // The clients by the interface of their registered app.
 	static esp_ble_sec_act_t 	m_securityLevel;
 	static BLESecurityCallbacks* m_securityCallbacks;
 	static uint16_t		m_localMTU;
+	static uint16_t     m_dataLength;
+	static std::deque<std::string> m_dataLengthPending;   // Addresses awaiting ESP_GAP_BLE_SET_PKT_LENGTH_COMPLETE_EVT, in request order.
+	static std::map<std::string, esp_ble_pkt_data_length_params_t> m_dataLengths;   // Negotiated data lengths by address.
+
+	static void          deleteClient(BLEClient* pClient);
+	static void          forgetDataLength(esp_bd_addr_t address);
+	static BLEClient*    getClient(esp_gatt_if_t gattc_if);
+	static void          removeClient(BLEClient* pClient);
+	static void          requestDataLength(esp_bd_addr_t address);
 
 	static esp_gatt_if_t getGattcIF();
 
@@ -0,0 +1,311 @@
+/*
+ * BLEDiscoveryCache.cpp
+ *
+ *  Created on: Oct 19, 2026
+ */
+#include "sdkconfig.h"
+#if defined(CONFIG_BT_ENABLED)
+#include <esp_log.h>
+#include <nvs.h>
+#include <string.h>
+#include "BLEDiscoveryCache.h"
+#include "BLEClient.h"
+#include "BLERemoteCharacteristic.h"
+#include "BLERemoteDescriptor.h"
+#include "BLERemoteService.h"
+#include "GeneralUtils.h"
+#ifdef ARDUINO_ARCH_ESP32
+#include "esp32-hal-log.h"
+#endif
+
+static const char* LOG_TAG = "BLEDiscoveryCache";
+
+static const char*   NVS_NAMESPACE = "BLEGattCache";
+static const uint8_t CACHE_VERSION = 1;
+
+// The cache is a header followed by one record per attribute, each characteristic after its service and
+// each descriptor after its characteristic:
+//
+// header:         'B' 'G' 'C' version hashLength hash[hashLength]
+// service:        'S' startHandle endHandle uuid
+// characteristic: 'C' handle properties uuid
+// descriptor:     'D' handle uuid
+//
+// Handles are two bytes, little endian.  A uuid is its length (2, 4 or 16) followed by its bytes as held in
+// an esp_bt_uuid_t.
+static const char RECORD_SERVICE        = 'S';
+static const char RECORD_CHARACTERISTIC = 'C';
+static const char RECORD_DESCRIPTOR     = 'D';
+
+
+static void putHandle(std::string& data, uint16_t handle) {
+	data += (char)(handle & 0xff);
+	data += (char)(handle >> 8);
+} // putHandle
+
+
+static void putUUID(std::string& data, BLEUUID uuid) {
+	esp_bt_uuid_t* pNative = uuid.getNative();
+	data += (char)pNative->len;
+	data.append((const char*)&pNative->uuid, pNative->len);
+} // putUUID
+
+
+static bool getHandle(const std::string& data, size_t& pos, uint16_t* pHandle) {
+	if (pos + 2 > data.length()) {
+		return false;
+	}
+	*pHandle = (uint8_t)data[pos] | ((uint8_t)data[pos + 1] << 8);
+	pos += 2;
+	return true;
+} // getHandle
+
+
+static bool getUUID(const std::string& data, size_t& pos, esp_bt_uuid_t* pUUID) {
+	if (pos >= data.length()) {
+		return false;
+	}
+	uint8_t length = data[pos++];
+	if ((length != ESP_UUID_LEN_16 && length != ESP_UUID_LEN_32 && length != ESP_UUID_LEN_128) || pos + length > data.length()) {
+		return false;
+	}
+	memset(pUUID, 0, sizeof(*pUUID));
+	pUUID->len = length;
+	memcpy(&pUUID->uuid, data.data() + pos, length);
+	pos += length;
+	return true;
+} // getUUID
+
+
+/**
+ * @brief Find the Database Hash characteristic among the discovered services.
+ * @param [in] pClient The client.
+ * @return The characteristic or nullptr if the server does not have one.
+ */
+BLERemoteCharacteristic* BLEDiscoveryCache::findDatabaseHash(BLEClient* pClient) {
+	auto it = pClient->m_servicesMap.find(BLEUUID((uint16_t)0x1801).toString());   // Generic Attribute.
+	if (it == pClient->m_servicesMap.end()) {
+		return nullptr;
+	}
+	std::map<std::string, BLERemoteCharacteristic*>* pCharacteristics = it->second->getCharacteristics();
+	auto itChar = pCharacteristics->find(BLEUUID((uint16_t)0x2b2a).toString());   // Database Hash.
+	return itChar == pCharacteristics->end() ? nullptr : itChar->second;
+} // findDatabaseHash
+
+
+/**
+ * @brief Forget the cached database of a server.
+ * @param [in] address The address of the server.
+ */
+void BLEDiscoveryCache::erase(BLEAddress address) {
+	nvs_handle handle;
+	if (::nvs_open(NVS_NAMESPACE, NVS_READWRITE, &handle) != ESP_OK) {
+		return;
+	}
+	if (::nvs_erase_key(handle, key(address).c_str()) == ESP_OK) {
+		ESP_LOGD(LOG_TAG, "Erased the cache for %s", address.toString().c_str());
+		::nvs_commit(handle);
+	}
+	::nvs_close(handle);
+} // erase
+
+
+/**
+ * @brief Forget the cached databases of all servers.
+ */
+void BLEDiscoveryCache::eraseAll() {
+	nvs_handle handle;
+	esp_err_t errRc = ::nvs_open(NVS_NAMESPACE, NVS_READWRITE, &handle);
+	if (errRc != ESP_OK) {
+		ESP_LOGE(LOG_TAG, "nvs_open: rc=%d %s", errRc, GeneralUtils::errorToString(errRc));
+		return;
+	}
+	::nvs_erase_all(handle);
+	::nvs_commit(handle);
+	::nvs_close(handle);
+} // eraseAll
+
+
+/**
+ * @brief Get the NVS key under which the database of a server is cached.
+ * @param [in] address The address of the server.
+ * @return The address as 12 hex digits.
+ */
+std::string BLEDiscoveryCache::key(BLEAddress address) {
+	char name[13];
+	uint8_t* pAddress = *address.getNative();
+	snprintf(name, sizeof(name), "%02x%02x%02x%02x%02x%02x",
+		pAddress[0], pAddress[1], pAddress[2], pAddress[3], pAddress[4], pAddress[5]);
+	return std::string(name);
+} // key
+
+
+/**
+ * @brief Load the cached database of a server.
+ * @param [in] address The address of the server.
+ * @param [out] pData The cached database.
+ * @return True if the server has a cached database.
+ */
+bool BLEDiscoveryCache::load(BLEAddress address, std::string* pData) {
+	nvs_handle handle;
+	if (::nvs_open(NVS_NAMESPACE, NVS_READONLY, &handle) != ESP_OK) {
+		return false;
+	}
+	size_t length = 0;
+	esp_err_t errRc = ::nvs_get_blob(handle, key(address).c_str(), nullptr, &length);
+	if (errRc == ESP_OK) {
+		pData->resize(length);
+		errRc = ::nvs_get_blob(handle, key(address).c_str(), &(*pData)[0], &length);
+	}
+	::nvs_close(handle);
+	return errRc == ESP_OK;
+} // load
+
+
+/**
+ * @brief Rebuild the services of a connected client from the cached database of its server.
+ * When the server has a Database Hash characteristic, its value is read and the cache is only used if the
+ * value matches the hash saved with it.
+ * @param [in] pClient The client.
+ * @return True if the services were restored, false if the client must discover them.
+ */
+bool BLEDiscoveryCache::restore(BLEClient* pClient) {
+	std::string data;
+	if (!load(pClient->getPeerAddress(), &data)) {
+		return false;
+	}
+	ESP_LOGD(LOG_TAG, ">> restore: %s, %d bytes", pClient->getPeerAddress().toString().c_str(), data.length());
+
+	size_t pos = 0;
+	bool   valid = data.length() >= 5 && data.compare(0, 3, "BGC") == 0 && data[3] == CACHE_VERSION;
+	std::string hash;
+	if (valid) {
+		uint8_t hashLength = data[4];
+		pos = 5 + hashLength;
+		valid = pos <= data.length();
+		if (valid) {
+			hash = data.substr(5, hashLength);
+		}
+	}
+
+	BLERemoteService*        pService        = nullptr;
+	BLERemoteCharacteristic* pCharacteristic = nullptr;
+	while (valid && pos < data.length()) {
+		char           type = data[pos++];
+		uint16_t       handle;
+		uint16_t       endHandle;
+		esp_bt_uuid_t  uuid;
+		if (type == RECORD_SERVICE) {
+			valid = getHandle(data, pos, &handle) && getHandle(data, pos, &endHandle) && getUUID(data, pos, &uuid);
+			if (valid) {
+				esp_gatt_id_t srvcId;
+				srvcId.uuid    = uuid;
+				srvcId.inst_id = 0;
+				pService = new BLERemoteService(srvcId, pClient, handle, endHandle);
+				pService->m_haveCharacteristics = true;
+				pClient->m_servicesMap.insert(std::pair<std::string, BLERemoteService*>(pService->getUUID().toString(), pService));
+				pCharacteristic = nullptr;
+			}
+		} else if (type == RECORD_CHARACTERISTIC && pService != nullptr && pos < data.length()) {
+			uint8_t properties;
+			valid = getHandle(data, pos, &handle) && pos < data.length();
+			if (valid) {
+				properties = data[pos++];
+				valid = getUUID(data, pos, &uuid);
+			}
+			if (valid) {
+				pCharacteristic = new BLERemoteCharacteristic(handle, BLEUUID(uuid), (esp_gatt_char_prop_t)properties, pService);
+				pService->m_characteristicMap.insert(std::pair<std::string, BLERemoteCharacteristic*>(pCharacteristic->getUUID().toString(), pCharacteristic));
+				pService->m_characteristicMapByHandle.insert(std::pair<uint16_t, BLERemoteCharacteristic*>(handle, pCharacteristic));
+				pClient->m_characteristicsByHandle[handle] = pCharacteristic;
+			}
+		} else if (type == RECORD_DESCRIPTOR && pCharacteristic != nullptr) {
+			valid = getHandle(data, pos, &handle) && getUUID(data, pos, &uuid);
+			if (valid) {
+				BLERemoteDescriptor* pDescriptor = new BLERemoteDescriptor(handle, BLEUUID(uuid), pCharacteristic);
+				pCharacteristic->m_descriptorMap.insert(std::pair<std::string, BLERemoteDescriptor*>(pDescriptor->getUUID().toString(), pDescriptor));
+			}
+		} else {
+			valid = false;
+		}
+	}
+
+	if (valid && !hash.empty()) {
+		BLERemoteCharacteristic* pHash = findDatabaseHash(pClient);
+		valid = pHash != nullptr && pHash->readValue() == hash;
+		if (!valid) {
+			ESP_LOGI(LOG_TAG, "Database hash of %s has changed", pClient->getPeerAddress().toString().c_str());
+		}
+	}
+
+	if (!valid) {
+		pClient->clearServices();
+		erase(pClient->getPeerAddress());
+		ESP_LOGD(LOG_TAG, "<< restore: cache discarded");
+		return false;
+	}
+	ESP_LOGD(LOG_TAG, "<< restore: %d services", pClient->m_servicesMap.size());
+	return true;
+} // restore
+
+
+/**
+ * @brief Save the discovered database of a connected client.
+ * The characteristics and descriptors of every service are retrieved first.  These come from the copy of the
+ * database held by the %BLE stack after the service search, so this does not involve the server, other than
+ * to read the Database Hash if there is one.
+ * @param [in] pClient The client.
+ */
+void BLEDiscoveryCache::save(BLEClient* pClient) {
+	std::string records;
+	for (auto &servicePair : pClient->m_servicesMap) {
+		BLERemoteService* pService = servicePair.second;
+		records += RECORD_SERVICE;
+		putHandle(records, pService->getStartHandle());
+		putHandle(records, pService->getEndHandle());
+		putUUID(records, pService->getUUID());
+		for (auto &charPair : *pService->getCharacteristics()) {
+			BLERemoteCharacteristic* pCharacteristic = charPair.second;
+			records += RECORD_CHARACTERISTIC;
+			putHandle(records, pCharacteristic->getHandle());
+			records += (char)pCharacteristic->m_charProp;
+			putUUID(records, pCharacteristic->getUUID());
+			for (auto &descrPair : *pCharacteristic->getDescriptors()) {
+				records += RECORD_DESCRIPTOR;
+				putHandle(records, descrPair.second->getHandle());
+				putUUID(records, descrPair.second->getUUID());
+			}
+		}
+	}
+
+	std::string hash;
+	BLERemoteCharacteristic* pHash = findDatabaseHash(pClient);
+	if (pHash != nullptr) {
+		hash = pHash->readValue();
+	}
+
+	std::string data = "BGC";
+	data += (char)CACHE_VERSION;
+	data += (char)hash.length();
+	data += hash;
+	data += records;
+
+	nvs_handle handle;
+	esp_err_t errRc = ::nvs_open(NVS_NAMESPACE, NVS_READWRITE, &handle);
+	if (errRc != ESP_OK) {
+		ESP_LOGE(LOG_TAG, "nvs_open: rc=%d %s", errRc, GeneralUtils::errorToString(errRc));
+		return;
+	}
+	errRc = ::nvs_set_blob(handle, key(pClient->getPeerAddress()).c_str(), data.data(), data.length());
+	if (errRc == ESP_OK) {
+		errRc = ::nvs_commit(handle);
+	}
+	if (errRc != ESP_OK) {
+		ESP_LOGE(LOG_TAG, "Unable to save the cache: rc=%d %s", errRc, GeneralUtils::errorToString(errRc));
+	} else {
+		ESP_LOGD(LOG_TAG, "Saved the cache for %s: %d bytes", pClient->getPeerAddress().toString().c_str(), data.length());
+	}
+	::nvs_close(handle);
+} // save
+
+#endif /* CONFIG_BT_ENABLED */
@@ -0,0 +1,47 @@
+/*
+ * BLEDiscoveryCache.h
+ *
+ *  Created on: Oct 19, 2026
+ */
+
+#ifndef COMPONENTS_CPP_UTILS_BLEDISCOVERYCACHE_H_
+#define COMPONENTS_CPP_UTILS_BLEDISCOVERYCACHE_H_
+#include "sdkconfig.h"
+#if defined(CONFIG_BT_ENABLED)
+#include <string>
+#include "BLEAddress.h"
+
+class BLEClient;
+class BLERemoteCharacteristic;
+
+/**
+ * @brief A persistent cache of the services, characteristics and descriptors discovered on remote servers.
+ *
+ * Discovering the attribute database of a server takes a full service search on every connection.  A client
+ * with the cache enabled (see BLEClient::setDiscoveryCache()) saves what it discovered in NVS, keyed by the
+ * address of the server, and on a later connection to the same server rebuilds its services from the cache
+ * without asking the server.
+ *
+ * A cached database is trusted until it is shown to be stale.  If the server has a Database Hash
+ * characteristic its value is saved with the cache and read back on each connection, one read in place of the
+ * service search, and a different hash discards the cache.  A Service Changed indication from the server also
+ * discards it.  A server that has neither, and is not bonded, can change its database unseen; erase() the
+ * entry when that is known to happen.
+ */
+class BLEDiscoveryCache {
+public:
+	static void erase(BLEAddress address);
+	static void eraseAll();
+
+private:
+	friend class BLEClient;
+
+	static BLERemoteCharacteristic* findDatabaseHash(BLEClient* pClient);
+	static bool        load(BLEAddress address, std::string* pData);
+	static bool        restore(BLEClient* pClient);
+	static void        save(BLEClient* pClient);
+	static std::string key(BLEAddress address);
+}; // BLEDiscoveryCache
+
+#endif /* CONFIG_BT_ENABLED */
+#endif /* COMPONENTS_CPP_UTILS_BLEDISCOVERYCACHE_H_ */
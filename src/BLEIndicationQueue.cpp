@@ -0,0 +1,266 @@
+/*
+ * BLEIndicationQueue.cpp
+ *
+ *  Created on: Oct 19, 2026
+ */
+#include "sdkconfig.h"
+#if defined(CONFIG_BT_ENABLED)
+#include <esp_log.h>
+#include <esp_gatts_api.h>
+#include "BLEIndicationQueue.h"
+#include "BLECharacteristic.h"
+#include "BLEService.h"
+#include "BLEServer.h"
+#include "GeneralUtils.h"
+#ifdef ARDUINO_ARCH_ESP32
+#include "esp32-hal-log.h"
+#endif
+
+static const char* LOG_TAG = "BLEIndicationQueue";
+
+static const uint8_t  DEFAULT_MAX_QUEUED = 8;
+static const uint32_t DEFAULT_TIMEOUT_MS = 30000;   // The ATT transaction timeout.
+static const uint32_t CHECK_PERIOD_MS    = 100;     // How often in flight indications are checked for a timeout.
+
+
+BLEIndicationQueue::BLEIndicationQueue() {
+	m_maxQueued = DEFAULT_MAX_QUEUED;
+	m_timeoutMs = DEFAULT_TIMEOUT_MS;
+	m_timer     = nullptr;
+	m_timerRunning = false;
+} // BLEIndicationQueue
+
+
+BLEIndicationQueue::~BLEIndicationQueue() {
+	if (m_timer != nullptr) {
+		::xTimerDelete(m_timer, portMAX_DELAY);
+	}
+} // ~BLEIndicationQueue
+
+
+/**
+ * @brief Handle the confirmation of an indication.
+ * The next indication queued on the connection, if any, is sent straight away.
+ * @param [in] connId The connection on which the confirmation arrived.
+ * @param [in] handle The handle of the attribute that was indicated.
+ * @param [in] status The status of the indication.
+ */
+void BLEIndicationQueue::confirm(uint16_t connId, uint16_t handle, esp_gatt_status_t status) {
+	std::vector<Outcome> outcomes;
+	m_semaphoreQueue.take("confirm");
+	auto it = m_connections.find(connId);
+	// ESP_GATTS_CONF_EVT also reports notifications, which are not tracked here.
+	if (it != m_connections.end() && it->second.inFlight && it->second.queue.front().pCharacteristic->getHandle() == handle) {
+		Connection& connection = it->second;
+		Outcome outcome;
+		outcome.pCharacteristic = connection.queue.front().pCharacteristic;
+		outcome.connId          = connId;
+		outcome.status          = status == ESP_GATT_OK ? BLECharacteristicCallbacks::SUCCESS_INDICATE : BLECharacteristicCallbacks::ERROR_GATT;
+		outcome.code            = status;
+		outcomes.push_back(outcome);
+		connection.queue.pop_front();
+		connection.inFlight = false;
+		sendNext(connId, connection, outcomes);
+	}
+	m_semaphoreQueue.give();
+	report(outcomes);
+} // confirm
+
+
+/**
+ * @brief Queue an indication.
+ * @param [in] pCharacteristic The characteristic to indicate.
+ * @param [in] connId The connection on which to indicate it.
+ * @param [in] pData The value to indicate.  It is copied.
+ * @param [in] length The length of the value.
+ * @param [out] pStatus Receives the BLECharacteristicCallbacks::Status that says why the indication was refused.
+ * @return True if the indication was queued, false if it was refused.
+ */
+bool BLEIndicationQueue::enqueue(BLECharacteristic* pCharacteristic, uint16_t connId, const uint8_t* pData, size_t length, uint8_t* pStatus) {
+	std::vector<Outcome> outcomes;
+	m_semaphoreQueue.take("enqueue");
+	if (m_timer == nullptr) {
+		m_timer = ::xTimerCreate("indicateTimeout", CHECK_PERIOD_MS / portTICK_PERIOD_MS, pdTRUE, this, timerCallback);
+	}
+	auto it = m_connections.find(connId);
+	if (it == m_connections.end()) {
+		// Not a connection of the server; an entry made for it would outlive the conn_id and refuse the next peer given it.
+		m_semaphoreQueue.give();
+		ESP_LOGD(LOG_TAG, "<< enqueue: connId=%d is not connected", connId);
+		*pStatus = BLECharacteristicCallbacks::ERROR_NO_CLIENT;
+		return false;
+	}
+	Connection& connection = it->second;
+	if (connection.timedOut || connection.queue.size() >= m_maxQueued) {
+		m_semaphoreQueue.give();
+		ESP_LOGD(LOG_TAG, "<< enqueue: connId=%d not accepting indications", connId);
+		*pStatus = connection.timedOut ? BLECharacteristicCallbacks::ERROR_INDICATE_TIMEOUT : BLECharacteristicCallbacks::ERROR_QUEUE_FULL;
+		return false;
+	}
+	Indication indication;
+	indication.pCharacteristic = pCharacteristic;
+	indication.value.assign((const char*)pData, length);
+	connection.queue.push_back(indication);
+	sendNext(connId, connection, outcomes);
+	// The running state is tracked under the lock rather than asked of the timer: a stop issued by
+	// checkTimeouts() only takes effect once the callback returns, and the timer would still look active.
+	if (m_timer != nullptr && !m_timerRunning) {
+		::xTimerStart(m_timer, 0);
+		m_timerRunning = true;
+	}
+	m_semaphoreQueue.give();
+	report(outcomes);
+	return true;
+} // enqueue
+
+
+/**
+ * @brief Fail every indication queued on a connection.
+ * @param [in] connId The connection.
+ * @param [in] connection The queue of the connection.
+ * @param [in] status The status to report for each indication.
+ * @param [out] outcomes The outcomes to report.
+ */
+void BLEIndicationQueue::failAll(uint16_t connId, Connection& connection, uint8_t status, std::vector<Outcome>& outcomes) {
+	for (auto &indication : connection.queue) {
+		Outcome outcome;
+		outcome.pCharacteristic = indication.pCharacteristic;
+		outcome.connId          = connId;
+		outcome.status          = status;
+		outcome.code            = 0;
+		outcomes.push_back(outcome);
+	}
+	connection.queue.clear();
+	connection.inFlight = false;
+} // failAll
+
+
+/**
+ * @brief Accept indications on a newly opened connection.
+ * @param [in] connId The connection.
+ */
+void BLEIndicationQueue::open(uint16_t connId) {
+	m_semaphoreQueue.take("open");
+	m_connections[connId] = Connection();   // A conn_id may be reused; start afresh.
+	m_semaphoreQueue.give();
+} // open
+
+
+/**
+ * @brief Discard the indications of a connection.
+ * Used when the connection is closed; each queued indication is reported as failed.
+ * @param [in] connId The connection.
+ */
+void BLEIndicationQueue::release(uint16_t connId) {
+	std::vector<Outcome> outcomes;
+	m_semaphoreQueue.take("release");
+	auto it = m_connections.find(connId);
+	if (it != m_connections.end()) {
+		failAll(connId, it->second, BLECharacteristicCallbacks::ERROR_NO_CLIENT, outcomes);
+		m_connections.erase(it);
+	}
+	m_semaphoreQueue.give();
+	report(outcomes);
+} // release
+
+
+/**
+ * @brief Send the indication at the head of the queue of a connection, if none is in flight.
+ * @param [in] connId The connection.
+ * @param [in] connection The queue of the connection.
+ * @param [out] outcomes Indications that could not be sent are added here.
+ */
+void BLEIndicationQueue::sendNext(uint16_t connId, Connection& connection, std::vector<Outcome>& outcomes) {
+	while (!connection.inFlight && !connection.queue.empty()) {
+		Indication& indication = connection.queue.front();
+		esp_err_t errRc = ::esp_ble_gatts_send_indicate(
+				indication.pCharacteristic->getService()->getServer()->getGattsIf(),
+				connId,
+				indication.pCharacteristic->getHandle(),
+				indication.value.length(),
+				(uint8_t*)indication.value.data(),
+				true); // The need_confirm = true makes this an indication.
+		if (errRc == ESP_OK) {
+			connection.inFlight = true;
+			connection.sentAt   = ::xTaskGetTickCount();
+			return;
+		}
+		ESP_LOGE(LOG_TAG, "esp_ble_gatts_send_indicate: rc=%d %s", errRc, GeneralUtils::errorToString(errRc));
+		Outcome outcome;
+		outcome.pCharacteristic = indication.pCharacteristic;
+		outcome.connId          = connId;
+		outcome.status          = BLECharacteristicCallbacks::ERROR_GATT;
+		outcome.code            = errRc;
+		outcomes.push_back(outcome);
+		connection.queue.pop_front();
+	}
+} // sendNext
+
+
+/**
+ * @brief Set the limits of the queue.
+ * @param [in] maxQueued The maximum number of indications queued on a connection, including the one in flight.
+ * @param [in] timeoutMs How long to wait for the confirmation of an indication.
+ */
+void BLEIndicationQueue::setLimits(uint8_t maxQueued, uint32_t timeoutMs) {
+	m_semaphoreQueue.take("setLimits");
+	m_maxQueued = maxQueued;
+	m_timeoutMs = timeoutMs;
+	m_semaphoreQueue.give();
+} // setLimits
+
+
+/**
+ * @brief Fail the indications that have not been confirmed in time.
+ */
+void BLEIndicationQueue::checkTimeouts() {
+	std::vector<Outcome> outcomes;
+	bool inFlight = false;
+	m_semaphoreQueue.take("checkTimeouts");
+	TickType_t now = ::xTaskGetTickCount();
+	for (auto &myPair : m_connections) {
+		Connection& connection = myPair.second;
+		if (!connection.inFlight) {
+			continue;
+		}
+		if ((now - connection.sentAt) * portTICK_PERIOD_MS >= m_timeoutMs) {
+			ESP_LOGE(LOG_TAG, "Indication not confirmed on connId=%d", myPair.first);
+			failAll(myPair.first, connection, BLECharacteristicCallbacks::ERROR_INDICATE_TIMEOUT, outcomes);
+			connection.timedOut = true;
+		} else {
+			inFlight = true;
+		}
+	}
+	if (!inFlight) {
+		::xTimerStop(m_timer, 0);
+		m_timerRunning = false;
+	}
+	m_semaphoreQueue.give();
+	report(outcomes);
+} // checkTimeouts
+
+
+/**
+ * @brief Report the outcome of indications to the callbacks of their characteristics.
+ * This is called without the queue locked so that a callback may queue further indications.
+ * @param [in] outcomes The outcomes to report.
+ */
+void BLEIndicationQueue::report(std::vector<Outcome>& outcomes) {
+	for (auto &outcome : outcomes) {
+		if (outcome.pCharacteristic->m_pCallbacks != nullptr) {
+			outcome.pCharacteristic->m_pCallbacks->onStatus(outcome.pCharacteristic,
+				(BLECharacteristicCallbacks::Status)outcome.status, outcome.connId, outcome.code);
+		}
+	}
+} // report
+
+
+/**
+ * @brief Timer callback that checks for unconfirmed indications.
+ * @param [in] timer The timer that expired; its ID is the queue.
+ */
+void BLEIndicationQueue::timerCallback(TimerHandle_t timer) {
+	((BLEIndicationQueue*)::pvTimerGetTimerID(timer))->checkTimeouts();
+} // timerCallback
+
+#endif /* CONFIG_BT_ENABLED */
@@ -0,0 +1,80 @@
+/*
+ * BLEIndicationQueue.h
+ *
+ *  Created on: Oct 19, 2026
+ */
+
+#ifndef COMPONENTS_CPP_UTILS_BLEINDICATIONQUEUE_H_
+#define COMPONENTS_CPP_UTILS_BLEINDICATIONQUEUE_H_
+#include "sdkconfig.h"
+#if defined(CONFIG_BT_ENABLED)
+#include <esp_gatt_defs.h>
+#include <deque>
+#include <map>
+#include <string>
+#include <vector>
+#include "FreeRTOS.h"
+#include <freertos/timers.h>
+
+class BLECharacteristic;
+
+/**
+ * @brief The indications waiting to be sent, or confirmed, on each connection.
+ *
+ * ATT allows a single unconfirmed indication per connection.  Indications queued with
+ * BLECharacteristic::indicateAsync() are held here and sent one after the other as the client confirms
+ * them, without blocking the task that queued them.  An indication that is not confirmed within the
+ * timeout fails, together with everything queued behind it on that connection, since ATT forbids
+ * further indications on a connection after a transaction timeout.  The outcome of every indication is
+ * reported through BLECharacteristicCallbacks::onStatus().
+ */
+class BLEIndicationQueue {
+public:
+	BLEIndicationQueue();
+	~BLEIndicationQueue();
+
+	void confirm(uint16_t connId, uint16_t handle, esp_gatt_status_t status);
+	bool enqueue(BLECharacteristic* pCharacteristic, uint16_t connId, const uint8_t* pData, size_t length, uint8_t* pStatus);
+	void open(uint16_t connId);
+	void release(uint16_t connId);
+	void setLimits(uint8_t maxQueued, uint32_t timeoutMs);
+
+private:
+	struct Indication {
+		BLECharacteristic* pCharacteristic;
+		std::string        value;
+	};
+
+	struct Connection {
+		std::deque<Indication> queue;      // The front indication is in flight when inFlight is set.
+		bool                   inFlight = false;
+		bool                   timedOut = false;   // No further indications may be sent on this connection.
+		TickType_t             sentAt   = 0;
+	};
+
+	struct Outcome {
+		BLECharacteristic* pCharacteristic;
+		uint16_t           connId;
+		uint8_t            status;         // A BLECharacteristicCallbacks::Status.
+		uint32_t           code;
+	};
+
+	BLEIndicationQueue(const BLEIndicationQueue&) = delete;
+	BLEIndicationQueue& operator=(const BLEIndicationQueue&) = delete;
+
+	void        checkTimeouts();
+	void        failAll(uint16_t connId, Connection& connection, uint8_t status, std::vector<Outcome>& outcomes);
+	void        sendNext(uint16_t connId, Connection& connection, std::vector<Outcome>& outcomes);
+	static void report(std::vector<Outcome>& outcomes);
+	static void timerCallback(TimerHandle_t timer);
+
+	std::map<uint16_t, Connection> m_connections;
+	uint8_t                        m_maxQueued;
+	uint32_t                       m_timeoutMs;
+	TimerHandle_t                  m_timer;
+	bool                           m_timerRunning;   // The timer has been started and not stopped, under the lock.
+	FreeRTOS::Semaphore            m_semaphoreQueue = FreeRTOS::Semaphore("IndicationQueue");
+}; // BLEIndicationQueue
+
+#endif /* CONFIG_BT_ENABLED */
+#endif /* COMPONENTS_CPP_UTILS_BLEINDICATIONQUEUE_H_ */
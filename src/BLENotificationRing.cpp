@@ -0,0 +1,194 @@
+/*
+ * BLENotificationRing.cpp
+ *
+ *  Created on: Oct 19, 2026
+ */
+#include "sdkconfig.h"
+#if defined(CONFIG_BT_ENABLED)
+#include <esp_log.h>
+#include <stdlib.h>
+#include <string.h>
+#include "BLENotificationRing.h"
+#include "BLEDevice.h"
+#ifdef ARDUINO_ARCH_ESP32
+#include "esp32-hal-log.h"
+#endif
+
+static const char* LOG_TAG = "BLENotificationRing";
+
+
+/**
+ * @brief Create a ring and allocate its slots.
+ * @param [in] slotCount The number of notifications the ring holds.
+ * @param [in] slotSize The largest notification kept whole, or 0 for the largest the local MTU allows.
+ */
+BLENotificationRing::BLENotificationRing(uint16_t slotCount, uint16_t slotSize) {
+	if (slotSize == 0) {
+		slotSize = BLEDevice::getMTU() - 3;
+	}
+	m_slotCount       = slotCount;
+	m_slotSize        = slotSize;
+	m_head            = 0;
+	m_filled          = 0;
+	m_lock            = portMUX_INITIALIZER_UNLOCKED;
+	m_overflowCount   = 0;
+	m_truncatedCount  = 0;
+	m_slots           = (Slot*)calloc(slotCount, sizeof(Slot));
+	m_pBuffer         = (uint8_t*)malloc((size_t)slotCount * slotSize);
+	m_semaphoreFilled = ::xSemaphoreCreateBinary();
+	if (m_slots == nullptr || m_pBuffer == nullptr) {
+		ESP_LOGE(LOG_TAG, "Unable to allocate %d slots of %d bytes", slotCount, slotSize);
+		m_slotCount = 0;   // Every notification will overflow.
+	}
+} // BLENotificationRing
+
+
+BLENotificationRing::~BLENotificationRing() {
+	free(m_slots);
+	free(m_pBuffer);
+	if (m_semaphoreFilled != nullptr) {
+		::vSemaphoreDelete(m_semaphoreFilled);
+	}
+} // ~BLENotificationRing
+
+
+/**
+ * @brief Take the oldest notifications in the ring.
+ * The notifications stay in their slots, and the slots stay filled, until they are released; release them
+ * before acquiring again, since a further acquire() starts again from the oldest.
+ * @param [out] pNotifications Receives the notifications, oldest first.
+ * @param [in] maxCount The most notifications to take.
+ * @param [in] timeoutMs How long to wait for a notification when the ring is empty; 0 not to wait, or
+ * portMAX_DELAY to wait for ever.
+ * @return The number of notifications taken, 0 if none arrived in time.
+ */
+size_t BLENotificationRing::acquire(Notification* pNotifications, size_t maxCount, uint32_t timeoutMs) {
+	TickType_t start = ::xTaskGetTickCount();
+	uint16_t head;
+	uint16_t filled;
+	while (true) {
+		portENTER_CRITICAL(&m_lock);
+		head   = m_head;
+		filled = m_filled;
+		portEXIT_CRITICAL(&m_lock);
+		if (filled > 0 || timeoutMs == 0 || m_semaphoreFilled == nullptr) {
+			break;
+		}
+		TickType_t wait = portMAX_DELAY;
+		if (timeoutMs != portMAX_DELAY) {
+			TickType_t waited = ::xTaskGetTickCount() - start;
+			TickType_t ticks  = timeoutMs / portTICK_PERIOD_MS;
+			if (waited >= ticks) {
+				break;
+			}
+			wait = ticks - waited;
+		}
+		::xSemaphoreTake(m_semaphoreFilled, wait);
+	}
+
+	size_t count = (filled < maxCount) ? filled : maxCount;
+	for (size_t i = 0; i < count; i++) {
+		uint16_t index = (head + i) % m_slotCount;
+		pNotifications[i].pCharacteristic = m_slots[index].pCharacteristic;
+		pNotifications[i].pData           = m_pBuffer + (size_t)index * m_slotSize;
+		pNotifications[i].length          = m_slots[index].length;
+		pNotifications[i].isNotify        = m_slots[index].isNotify;
+	}
+	return count;
+} // acquire
+
+
+/**
+ * @brief Get the number of notifications dropped because every slot was full.
+ * @return The number of notifications dropped.
+ */
+uint32_t BLENotificationRing::getOverflowCount() {
+	return m_overflowCount;
+} // getOverflowCount
+
+
+/**
+ * @brief Get the size of a slot, the largest notification kept whole.
+ * @return The size of a slot.
+ */
+uint16_t BLENotificationRing::getSlotSize() {
+	return m_slotSize;
+} // getSlotSize
+
+
+/**
+ * @brief Get the number of notifications truncated because they were larger than a slot.
+ * @return The number of notifications truncated.
+ */
+uint32_t BLENotificationRing::getTruncatedCount() {
+	return m_truncatedCount;
+} // getTruncatedCount
+
+
+/**
+ * @brief Copy a notification into the next free slot.
+ * Called on the %BLE task; it never blocks.
+ * @param [in] pCharacteristic The characteristic notified.
+ * @param [in] pData The value notified.
+ * @param [in] length The length of the value.
+ * @param [in] isNotify True for a notification, false for an indication.
+ * @return True if the notification was kept, false if the ring was full.
+ */
+bool BLENotificationRing::push(BLERemoteCharacteristic* pCharacteristic, const uint8_t* pData, size_t length, bool isNotify) {
+	portENTER_CRITICAL(&m_lock);
+	uint16_t head   = m_head;
+	uint16_t filled = m_filled;
+	portEXIT_CRITICAL(&m_lock);
+	if (filled >= m_slotCount) {
+		m_overflowCount++;
+		ESP_LOGD(LOG_TAG, "Ring full, notification dropped");
+		return false;
+	}
+
+	// The free slot is not seen by acquire() until it is counted as filled, so it is written unlocked.
+	uint16_t index = (head + filled) % m_slotCount;
+	if (length > m_slotSize) {
+		m_truncatedCount++;
+		length = m_slotSize;
+	}
+	memcpy(m_pBuffer + (size_t)index * m_slotSize, pData, length);
+	m_slots[index].pCharacteristic = pCharacteristic;
+	m_slots[index].length          = length;
+	m_slots[index].isNotify        = isNotify;
+
+	portENTER_CRITICAL(&m_lock);
+	m_filled++;
+	portEXIT_CRITICAL(&m_lock);
+	if (m_semaphoreFilled != nullptr) {
+		::xSemaphoreGive(m_semaphoreFilled);
+	}
+	return true;
+} // push
+
+
+/**
+ * @brief Return the oldest slots to the ring once their notifications have been handled.
+ * @param [in] count The number of notifications handled, normally the count returned by acquire().
+ */
+void BLENotificationRing::release(size_t count) {
+	portENTER_CRITICAL(&m_lock);
+	if (count > m_filled) {
+		count = m_filled;
+	}
+	if (count > 0) {
+		m_head    = (m_head + count) % m_slotCount;
+		m_filled -= count;
+	}
+	portEXIT_CRITICAL(&m_lock);
+} // release
+
+
+/**
+ * @brief Reset the overflow and truncation counters to zero.
+ */
+void BLENotificationRing::resetCounters() {
+	m_overflowCount  = 0;
+	m_truncatedCount = 0;
+} // resetCounters
+
+#endif /* CONFIG_BT_ENABLED */
@@ -0,0 +1,84 @@
+/*
+ * BLENotificationRing.h
+ *
+ *  Created on: Oct 19, 2026
+ */
+
+#ifndef COMPONENTS_CPP_UTILS_BLENOTIFICATIONRING_H_
+#define COMPONENTS_CPP_UTILS_BLENOTIFICATIONRING_H_
+#include "sdkconfig.h"
+#if defined(CONFIG_BT_ENABLED)
+#include <stddef.h>
+#include <stdint.h>
+#include "FreeRTOS.h"
+#include <freertos/semphr.h>
+
+class BLERemoteCharacteristic;
+
+/**
+ * @brief A ring of received notifications, drained in batches by an application task.
+ *
+ * A notification callback runs on the %BLE task, so a callback that forwards the data (over Wi-Fi, say)
+ * stalls the stack.  A characteristic registered with a ring instead (see
+ * BLERemoteCharacteristic::registerForNotify(BLENotificationRing&)) has each notification copied straight
+ * from the event into the next free slot, and the application takes the filled slots in batches:
+ *
+ * @code
+ * BLENotificationRing::Notification batch[8];
+ * size_t count = ring.acquire(batch, 8, 1000);
+ * for (size_t i = 0; i < count; i++) { ... batch[i].pData, batch[i].length ... }
+ * ring.release(count);
+ * @endcode
+ *
+ * The slots are allocated once, each sized for the largest notification the MTU allows.  When every slot is
+ * full a new notification is dropped and counted, rather than overwriting data the application may be
+ * reading.  One ring may be shared by several characteristics, of one client or several, but must be
+ * drained by a single task.
+ */
+class BLENotificationRing {
+public:
+	struct Notification {
+		BLERemoteCharacteristic* pCharacteristic;
+		const uint8_t*           pData;      // Valid until the notification is released.
+		uint16_t                 length;
+		bool                     isNotify;   // False for an indication.
+	};
+
+	BLENotificationRing(uint16_t slotCount = 16, uint16_t slotSize = 0);
+	~BLENotificationRing();
+
+	size_t   acquire(Notification* pNotifications, size_t maxCount, uint32_t timeoutMs = 0);
+	uint32_t getOverflowCount();
+	uint16_t getSlotSize();
+	uint32_t getTruncatedCount();
+	void     release(size_t count);
+	void     resetCounters();
+
+private:
+	friend class BLERemoteCharacteristic;
+
+	struct Slot {
+		BLERemoteCharacteristic* pCharacteristic;
+		uint16_t                 length;
+		bool                     isNotify;
+	};
+
+	BLENotificationRing(const BLENotificationRing&) = delete;
+	BLENotificationRing& operator=(const BLENotificationRing&) = delete;
+
+	bool push(BLERemoteCharacteristic* pCharacteristic, const uint8_t* pData, size_t length, bool isNotify);
+
+	Slot*             m_slots;
+	uint8_t*          m_pBuffer;          // The data of slot i starts at i * m_slotSize.
+	uint16_t          m_slotCount;
+	uint16_t          m_slotSize;
+	uint16_t          m_head;             // The oldest filled slot.
+	uint16_t          m_filled;
+	SemaphoreHandle_t m_semaphoreFilled;  // Given when a slot is filled, to wake a waiting acquire().
+	portMUX_TYPE      m_lock;
+	uint32_t          m_overflowCount;
+	uint32_t          m_truncatedCount;
+}; // BLENotificationRing
+
+#endif /* CONFIG_BT_ENABLED */
+#endif /* COMPONENTS_CPP_UTILS_BLENOTIFICATIONRING_H_ */
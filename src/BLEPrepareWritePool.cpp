@@ -0,0 +1,194 @@
+/*
+ * BLEPrepareWritePool.cpp
+ *
+ *  Created on: Oct 18, 2026
+ */
+#include "sdkconfig.h"
+#if defined(CONFIG_BT_ENABLED)
+#include <esp_log.h>
+#include <stdlib.h>
+#include <string.h>
+#include "BLEPrepareWritePool.h"
+#ifdef ARDUINO_ARCH_ESP32
+#include "esp32-hal-log.h"
+#endif
+
+static const char* LOG_TAG = "BLEPrepareWritePool";
+
+static const uint8_t DEFAULT_MAX_SLOTS = 2;
+
+
+BLEPrepareWritePool::BLEPrepareWritePool() {
+	setLimits(DEFAULT_MAX_SLOTS, ESP_GATT_MAX_ATTR_LEN);
+} // BLEPrepareWritePool
+
+
+BLEPrepareWritePool::~BLEPrepareWritePool() {
+	for (auto &slot : m_slots) {
+		free(slot.pBuffer);
+	}
+} // ~BLEPrepareWritePool
+
+
+/**
+ * @brief Discard a prepared write and return its slot to the pool.
+ * @param [in] connId The connection that prepared the write.
+ * @param [in] handle The attribute that was being written.
+ */
+void BLEPrepareWritePool::cancel(uint16_t connId, uint16_t handle) {
+	Slot* pSlot = find(connId, handle);
+	if (pSlot != nullptr) {
+		pSlot->inUse  = false;
+		pSlot->length = 0;
+	}
+} // cancel
+
+
+/**
+ * @brief Commit a prepared write into a value.
+ * The assembled data is copied into the value, whose buffer only ever grows, and the slot keeps its own
+ * full size buffer for the next prepared write.  Neither side touches the heap once both are large enough.
+ * @param [in] connId The connection that prepared the write.
+ * @param [in] handle The attribute that was being written.
+ * @param [in] pValue The value that receives the written data.
+ * @return True if there was a prepared write to commit.
+ */
+bool BLEPrepareWritePool::commit(uint16_t connId, uint16_t handle, BLEValue* pValue) {
+	Slot* pSlot = find(connId, handle);
+	if (pSlot == nullptr) {
+		return false;
+	}
+	ESP_LOGD(LOG_TAG, ">> commit: connId=%d, handle=0x%.2x, length=%d", connId, handle, pSlot->length);
+	pValue->setValue(pSlot->pBuffer, pSlot->length);
+	pSlot->inUse  = false;
+	pSlot->length = 0;
+	return true;
+} // commit
+
+
+/**
+ * @brief Determine whether a prepared write is pending.
+ * @param [in] connId The connection that prepared the write.
+ * @param [in] handle The attribute that was being written.
+ * @return True if a prepared write is waiting for execution.
+ */
+bool BLEPrepareWritePool::isPending(uint16_t connId, uint16_t handle) {
+	return find(connId, handle) != nullptr;
+} // isPending
+
+
+/**
+ * @brief Release every slot held by a connection.
+ * Used when a connection is closed or after an execute write has been processed.
+ * @param [in] connId The connection whose prepared writes are to be discarded.
+ */
+void BLEPrepareWritePool::release(uint16_t connId) {
+	for (auto &slot : m_slots) {
+		if (slot.inUse && slot.connId == connId) {
+			slot.inUse  = false;
+			slot.length = 0;
+		}
+	}
+} // release
+
+
+/**
+ * @brief Set the size of the pool.
+ * This should be called before any client connects.  Any pending prepared writes are discarded.
+ * @param [in] maxSlots The number of prepared writes that may be in progress at the same time.
+ * @param [in] maxLength The maximum length of a value assembled by a prepared write.
+ */
+void BLEPrepareWritePool::setLimits(uint8_t maxSlots, uint16_t maxLength) {
+	ESP_LOGD(LOG_TAG, ">> setLimits: maxSlots=%d, maxLength=%d", maxSlots, maxLength);
+	if (maxLength > ESP_GATT_MAX_ATTR_LEN) {
+		ESP_LOGE(LOG_TAG, "Length %d too large, must be no bigger than %d", maxLength, ESP_GATT_MAX_ATTR_LEN);
+		maxLength = ESP_GATT_MAX_ATTR_LEN;
+	}
+	for (auto &slot : m_slots) {
+		free(slot.pBuffer);
+	}
+	m_maxLength = maxLength;
+	m_slots.resize(maxSlots);
+	for (auto &slot : m_slots) {
+		slot.inUse    = false;
+		slot.connId   = 0;
+		slot.handle   = 0;
+		slot.pBuffer  = nullptr;
+		slot.capacity = 0;
+		slot.length   = 0;
+	}
+} // setLimits
+
+
+/**
+ * @brief Add a fragment to a prepared write.
+ * @param [in] connId The connection that is preparing the write.
+ * @param [in] handle The attribute being written.
+ * @param [in] offset The offset within the value at which the fragment is to be placed.
+ * @param [in] pData The fragment.
+ * @param [in] length The length of the fragment.
+ * @return ESP_GATT_OK on success, otherwise the ATT error to report to the client.
+ */
+esp_gatt_status_t BLEPrepareWritePool::write(uint16_t connId, uint16_t handle, uint16_t offset, const uint8_t* pData, uint16_t length) {
+	Slot* pSlot = find(connId, handle);
+	if (pSlot == nullptr) {
+		for (auto &slot : m_slots) {
+			if (!slot.inUse) {
+				pSlot = &slot;
+				break;
+			}
+		}
+		if (pSlot == nullptr) {
+			ESP_LOGE(LOG_TAG, "No free prepared write slot for connId=%d, handle=0x%.2x", connId, handle);
+			return ESP_GATT_PREPARE_Q_FULL;
+		}
+		pSlot->inUse  = true;
+		pSlot->connId = connId;
+		pSlot->handle = handle;
+		pSlot->length = 0;
+	}
+
+	// The fragment may overwrite data already written but it may not leave a gap.
+	if (offset > pSlot->length) {
+		ESP_LOGE(LOG_TAG, "Prepared write offset %d beyond current length %d", offset, pSlot->length);
+		return ESP_GATT_INVALID_OFFSET;
+	}
+	if ((size_t)offset + length > m_maxLength) {
+		ESP_LOGE(LOG_TAG, "Prepared write of %d bytes exceeds the maximum of %d", offset + length, m_maxLength);
+		return ESP_GATT_INVALID_ATTR_LEN;
+	}
+
+	if (pSlot->capacity < m_maxLength) {
+		uint8_t* pNew = (uint8_t*)realloc(pSlot->pBuffer, m_maxLength);
+		if (pNew == nullptr) {
+			ESP_LOGE(LOG_TAG, "Unable to allocate %d bytes for a prepared write", m_maxLength);
+			return ESP_GATT_NO_RESOURCES;
+		}
+		pSlot->pBuffer  = pNew;
+		pSlot->capacity = m_maxLength;
+	}
+
+	memcpy(pSlot->pBuffer + offset, pData, length);
+	if (offset + length > pSlot->length) {
+		pSlot->length = offset + length;
+	}
+	return ESP_GATT_OK;
+} // write
+
+
+/**
+ * @brief Find the slot holding a prepared write.
+ * @param [in] connId The connection that prepared the write.
+ * @param [in] handle The attribute that was being written.
+ * @return The slot or nullptr if there is no such prepared write.
+ */
+BLEPrepareWritePool::Slot* BLEPrepareWritePool::find(uint16_t connId, uint16_t handle) {
+	for (auto &slot : m_slots) {
+		if (slot.inUse && slot.connId == connId && slot.handle == handle) {
+			return &slot;
+		}
+	}
+	return nullptr;
+} // find
+
+#endif /* CONFIG_BT_ENABLED */
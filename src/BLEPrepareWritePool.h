@@ -0,0 +1,55 @@
+/*
+ * BLEPrepareWritePool.h
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#ifndef COMPONENTS_CPP_UTILS_BLEPREPAREWRITEPOOL_H_
+#define COMPONENTS_CPP_UTILS_BLEPREPAREWRITEPOOL_H_
+#include "sdkconfig.h"
+#if defined(CONFIG_BT_ENABLED)
+#include <esp_gatt_defs.h>
+#include <vector>
+#include "BLEValue.h"
+
+/**
+ * @brief A fixed pool of buffers used to assemble prepared (queued) writes.
+ *
+ * A client performs a long write by sending a series of Prepare Write requests followed by a single
+ * Execute Write request.  Each connection/attribute pair being written holds one slot from this pool
+ * until the write is executed or cancelled.  Slot buffers are allocated at their maximum size on first
+ * use and are then reused, so repeated long writes do not fragment the heap.
+ */
+class BLEPrepareWritePool {
+public:
+	BLEPrepareWritePool();
+	~BLEPrepareWritePool();
+
+	void              cancel(uint16_t connId, uint16_t handle);
+	bool              commit(uint16_t connId, uint16_t handle, BLEValue* pValue);
+	bool              isPending(uint16_t connId, uint16_t handle);
+	void              release(uint16_t connId);
+	void              setLimits(uint8_t maxSlots, uint16_t maxLength);
+	esp_gatt_status_t write(uint16_t connId, uint16_t handle, uint16_t offset, const uint8_t* pData, uint16_t length);
+
+private:
+	struct Slot {
+		bool     inUse;
+		uint16_t connId;
+		uint16_t handle;
+		uint8_t* pBuffer;
+		size_t   capacity;
+		size_t   length;
+	};
+
+	BLEPrepareWritePool(const BLEPrepareWritePool&) = delete;
+	BLEPrepareWritePool& operator=(const BLEPrepareWritePool&) = delete;
+
+	Slot* find(uint16_t connId, uint16_t handle);
+
+	std::vector<Slot> m_slots;
+	uint16_t          m_maxLength;
+}; // BLEPrepareWritePool
+
+#endif /* CONFIG_BT_ENABLED */
+#endif /* COMPONENTS_CPP_UTILS_BLEPREPAREWRITEPOOL_H_ */
@@ -14,6 +14,7 @@
 #include <esp_log.h>
 #include <esp_err.h>
 
+#include <algorithm>
 #include <sstream>
 #include "BLEExceptions.h"
 #include "BLEUtils.h"
@@ -43,9 +44,10 @@ BLERemoteCharacteristic::BLERemoteCharacteristic(
 	m_uuid           = uuid;
 	m_charProp       = charProp;
 	m_pRemoteService = pRemoteService;
-	m_notifyCallback = nullptr;
-
-	retrieveDescriptors(); // Get the descriptors for this characteristic
+	m_notifyCallback    = nullptr;
+	m_pNotificationRing = nullptr;
+	m_streamCredits     = nullptr;
+	m_streamStatus      = ESP_GATT_OK;
 	ESP_LOGD(LOG_TAG, "<< BLERemoteCharacteristic");
 } // BLERemoteCharacteristic
 
@@ -170,7 +172,9 @@ void BLERemoteCharacteristic::gattClientEventHandler(
 			if (evtParam->notify.handle != getHandle()) {
 				break;
 			}
-			if (m_notifyCallback != nullptr) {
+			if (m_pNotificationRing != nullptr) {
+				m_pNotificationRing->push(this, evtParam->notify.value, evtParam->notify.value_len, evtParam->notify.is_notify);
+			} else if (m_notifyCallback != nullptr) {
 				ESP_LOGD(LOG_TAG, "Invoking callback for notification on characteristic %s", toString().c_str());
 				m_notifyCallback(
 					this,
@@ -182,93 +186,8 @@ void BLERemoteCharacteristic::gattClientEventHandler(
 			break;
 		} // ESP_GATTC_NOTIFY_EVT
 
-
-		//
-		// ESP_GATTC_READ_CHAR_EVT
-		// This event indicates that the server has responded to the read request.
-		//
-		// read:
-		// - esp_gatt_status_t  status
-		// - uint16_t           conn_id
-		// - uint16_t           handle
-		// - uint8_t*           value
-		// - uint16_t           value_len
-	  //
-		case ESP_GATTC_READ_CHAR_EVT: {
-			// If this event is not for us, then nothing further to do.
-			if (evtParam->read.handle != getHandle()) {
-				break;
-			}
-
-			// At this point, we have determined that the event is for us, so now we save the value
-			// and unlock the semaphore to ensure that the requestor of the data can continue.
-			if (evtParam->read.status == ESP_GATT_OK) {
-				m_value = std::string((char*)evtParam->read.value, evtParam->read.value_len);
-			} else {
-				m_value = "";
-			}
-
-			m_semaphoreReadCharEvt.give();
-			break;
-		} // ESP_GATTC_READ_CHAR_EVT
-
-
-		//
-		// ESP_GATTC_REG_FOR_NOTIFY_EVT
-		//
-		// reg_for_notify:
-		// - esp_gatt_status_t status
-		// - uint16_t          handle
-		//
-		case ESP_GATTC_REG_FOR_NOTIFY_EVT: {
-			// If the request is not for this BLERemoteCharacteristic then move on to the next.
-			if (evtParam->reg_for_notify.handle != getHandle()) {
-				break;
-			}
-
-			// We have processed the notify registration and can unlock the semaphore.
-			m_semaphoreRegForNotifyEvt.give();
-			break;
-		} // ESP_GATTC_REG_FOR_NOTIFY_EVT
-
-
-		//
-		// ESP_GATTC_UNREG_FOR_NOTIFY_EVT
-		//
-		// unreg_for_notify:
-		// - esp_gatt_status_t status
-		// - uint16_t          handle
-		//
-		case ESP_GATTC_UNREG_FOR_NOTIFY_EVT: {
-			if (evtParam->unreg_for_notify.handle != getHandle()) {
-				break;
-			}
-			// We have processed the notify un-registration and can unlock the semaphore.
-			m_semaphoreRegForNotifyEvt.give();
-			break;
-		} // ESP_GATTC_UNREG_FOR_NOTIFY_EVT:
-
-
-		//
-		// ESP_GATTC_WRITE_CHAR_EVT
-		//
-		// write:
-		// - esp_gatt_status_t status
-		// - uint16_t          conn_id
-		// - uint16_t          handle
-		//
-		case ESP_GATTC_WRITE_CHAR_EVT: {
-			// Determine if this event is for us and, if not, pass onwards.
-			if (evtParam->write.handle != getHandle()) {
-				break;
-			}
-
-			// There is nothing further we need to do here.  This is merely an indication
-			// that the write has completed and we can unlock the caller.
-			m_semaphoreWriteCharEvt.give();
-			break;
-		} // ESP_GATTC_WRITE_CHAR_EVT
-
+		// The completions of reads, writes and notification registrations are handled by the
+		// BLERemoteRequestQueue of the client.
 
 		default: {
 			break;
@@ -277,60 +196,6 @@ void BLERemoteCharacteristic::gattClientEventHandler(
 }; // gattClientEventHandler
 
 
-/**
- * @brief Populate the descriptors (if any) for this characteristic.
- */
-void BLERemoteCharacteristic::retrieveDescriptors() {
-	ESP_LOGD(LOG_TAG, ">> retrieveDescriptors() for characteristic: %s", getUUID().toString().c_str());
-
-	removeDescriptors();   // Remove any existing descriptors.
-
-	// Loop over each of the descriptors within the service associated with this characteristic.
-	// For each descriptor we find, create a BLERemoteDescriptor instance.
-	uint16_t offset = 0;
-	esp_gattc_descr_elem_t result;
-	while(1) {
-		uint16_t count = 1;
-		esp_gatt_status_t status = ::esp_ble_gattc_get_all_descr(
-			getRemoteService()->getClient()->getGattcIf(),
-			getRemoteService()->getClient()->getConnId(),
-			getHandle(),
-			&result,
-			&count,
-			offset
-		);
-
-		if (status == ESP_GATT_INVALID_OFFSET) {   // We have reached the end of the entries.
-			break;
-		}
-
-		if (status != ESP_GATT_OK) {
-			ESP_LOGE(LOG_TAG, "esp_ble_gattc_get_all_descr: %s", BLEUtils::gattStatusToString(status).c_str());
-			break;
-		}
-
-		if (count == 0) {
-			break;
-		}
-		ESP_LOGE(LOG_TAG, "");
-		ESP_LOGD(LOG_TAG, "Found a descriptor: Handle: %d, UUID: %s", result.handle, BLEUUID(result.uuid).toString().c_str());
-
-		// We now have a new characteristic ... let us add that to our set of known characteristics
-		BLERemoteDescriptor *pNewRemoteDescriptor = new BLERemoteDescriptor(
-			result.handle,
-			BLEUUID(result.uuid),
-			this
-		);
-
-		m_descriptorMap.insert(std::pair<std::string, BLERemoteDescriptor*>(pNewRemoteDescriptor->getUUID().toString(), pNewRemoteDescriptor));
-
-		offset++;
-	} // while true
-	//m_haveCharacteristics = true; // Remember that we have received the characteristics.
-	ESP_LOGD(LOG_TAG, "<< retrieveDescriptors(): Found %d descriptors.", offset);
-} // getDescriptors
-
-
 /**
  * @brief Retrieve the map of descriptors keyed by UUID.
  */
@@ -378,6 +243,15 @@ BLERemoteService* BLERemoteCharacteristic::getRemoteService() {
 } // getRemoteService
 
 
+/**
+ * @brief Get the queue through which the requests of this characteristic are sent.
+ * @return The request queue of the client.
+ */
+BLERemoteRequestQueue* BLERemoteCharacteristic::getRequestQueue() {
+	return m_pRemoteService->getClient()->m_pRequestQueue;
+} // getRequestQueue
+
+
 /**
  * @brief Get the UUID for this characteristic.
  * @return The UUID for this characteristic.
@@ -392,11 +266,7 @@ BLEUUID BLERemoteCharacteristic::getUUID() {
  * @return The unsigned 16 bit value.
  */
 uint16_t BLERemoteCharacteristic::readUInt16(void) {
-	std::string value = readValue();
-	if (value.length() >= 2) {
-		return *(uint16_t*)(value.data());
-	}
-	return 0;
+	return read<uint16_t>();
 } // readUInt16
 
 
@@ -405,11 +275,7 @@ uint16_t BLERemoteCharacteristic::readUInt16(void) {
  * @return the unsigned 32 bit value.
  */
 uint32_t BLERemoteCharacteristic::readUInt32(void) {
-	std::string value = readValue();
-	if (value.length() >= 4) {
-		return *(uint32_t*)(value.data());
-	}
-	return 0;
+	return read<uint32_t>();
 } // readUInt32
 
 
@@ -418,14 +284,45 @@ uint32_t BLERemoteCharacteristic::readUInt32(void) {
  * @return The value as a byte
  */
 uint8_t BLERemoteCharacteristic::readUInt8(void) {
-	std::string value = readValue();
-	if (value.length() >= 1) {
-		return (uint8_t)value[0];
-	}
-	return 0;
+	return read<uint8_t>();
 } // readUInt8
 
 
+/**
+ * @brief Read the value of the remote characteristic into a buffer.
+ * The value is copied once, from the response straight into the buffer, with no intermediate string.
+ * @param [in] pBuffer The buffer to receive the value.
+ * @param [in] capacity The size of the buffer.  A longer value is truncated.
+ * @return The length of the value copied, 0 if the read failed.
+ * @throws BLEDisconnectedException
+ */
+uint16_t BLERemoteCharacteristic::readInto(uint8_t* pBuffer, uint16_t capacity) {
+	ESP_LOGD(LOG_TAG, ">> readInto(): handle: %d 0x%.2x, capacity: %d", getHandle(), getHandle(), capacity);
+
+	// Check to see that we are connected.
+	if (!getRemoteService()->getClient()->isConnected()) {
+		ESP_LOGE(LOG_TAG, "Disconnected");
+		throw BLEDisconnectedException();
+	}
+
+	uint16_t length = 0;
+	BLERemoteRequestQueue::Slot slot;
+	slot.pCharacteristic = this;
+	slot.pBuffer         = pBuffer;
+	slot.size            = capacity;
+	slot.pLength         = &length;
+	BLERemoteRequestQueue::Batch batch;
+	batch.pSemaphore = &m_semaphoreReadCharEvt;
+
+	m_semaphoreReadCharEvt.take("readInto");
+	getRequestQueue()->enqueueRead(&batch, slot);
+	getRequestQueue()->waitReads(&batch);
+
+	ESP_LOGD(LOG_TAG, "<< readInto(): length: %d, status: %d", length, batch.status);
+	return length;
+} // readInto
+
+
 /**
  * @brief Read the value of the remote characteristic.
  * @return The value of the remote characteristic.
@@ -441,22 +338,13 @@ std::string BLERemoteCharacteristic::readValue() {
 
 	m_semaphoreReadCharEvt.take("readValue");
 
-	// Ask the BLE subsystem to retrieve the value for the remote hosted characteristic.
-	// This is an asynchronous request which means that we must block waiting for the response
-	// to become available.
-	esp_err_t errRc = ::esp_ble_gattc_read_char(
-		m_pRemoteService->getClient()->getGattcIf(),
-		m_pRemoteService->getClient()->getConnId(),    // The connection ID to the BLE server
-		getHandle(),                                   // The handle of this characteristic
-		ESP_GATT_AUTH_REQ_NONE);                       // Security
-
-	if (errRc != ESP_OK) {
-		ESP_LOGE(LOG_TAG, "esp_ble_gattc_read_char: rc=%d %s", errRc, GeneralUtils::errorToString(errRc));
+	// Queue the read behind any other request on the connection and block waiting for it to complete.
+	// When it has, the std::string found in m_value will contain our data.
+	if (!getRequestQueue()->enqueue(BLERemoteRequestQueue::READ, this, nullptr, 0, readComplete, 0)) {
+		m_semaphoreReadCharEvt.give();
+		ESP_LOGE(LOG_TAG, "<< readValue(): unable to queue the read");
 		return "";
 	}
-
-	// Block waiting for the event that indicates that the read has completed.  When it has, the std::string found
-	// in m_value will contain our data.
 	m_semaphoreReadCharEvt.wait("readValue");
 
 	ESP_LOGD(LOG_TAG, "<< readValue(): length: %d", m_value.length());
@@ -464,6 +352,33 @@ std::string BLERemoteCharacteristic::readValue() {
 } // readValue
 
 
+/**
+ * @brief Read the value of the remote characteristic without waiting for it.
+ * The read is sent once the requests queued before it on the connection have completed.  The callback is
+ * invoked on the %BLE task with the value read; it must not block.
+ * @param [in] callback The function to call with the outcome of the read.
+ * @param [in] timeoutMs How long the read may take, counted from now, or 0 to wait for ever.
+ * @return True if the read was queued.
+ */
+bool BLERemoteCharacteristic::readValueAsync(BLERemoteRequestQueue::Callback callback, uint32_t timeoutMs) {
+	ESP_LOGD(LOG_TAG, ">> readValueAsync(): uuid: %s", getUUID().toString().c_str());
+	return getRequestQueue()->enqueue(BLERemoteRequestQueue::READ, this, nullptr, 0, callback, timeoutMs);
+} // readValueAsync
+
+
+/**
+ * @brief Completion of a blocking read: save the value and release the reader.
+ */
+void BLERemoteCharacteristic::readComplete(BLERemoteCharacteristic* pCharacteristic, esp_gatt_status_t status, uint8_t* pData, size_t length) {
+	if (status == ESP_GATT_OK) {
+		pCharacteristic->m_value = std::string((char*)pData, length);
+	} else {
+		pCharacteristic->m_value = "";
+	}
+	pCharacteristic->m_semaphoreReadCharEvt.give();
+} // readComplete
+
+
 /**
  * @brief Register for notifications.
  * @param [in] notifyCallback A callback to be invoked for a notification.  If NULL is provided then we are
@@ -477,38 +392,79 @@ void BLERemoteCharacteristic::registerForNotify(
 			size_t                   length,
 			bool                     isNotify)) {
 	ESP_LOGD(LOG_TAG, ">> registerForNotify(): %s", toString().c_str());
+	m_notifyCallback    = notifyCallback;   // Save the notification callback.
+	m_pNotificationRing = nullptr;
+	registerNotify(notifyCallback != nullptr);
+	ESP_LOGD(LOG_TAG, "<< registerForNotify()");
+} // registerForNotify
+
 
-	m_notifyCallback = notifyCallback;   // Save the notification callback.
+/**
+ * @brief Register for notifications, kept in a ring for the application to drain.
+ * Each notification is copied into the ring on the %BLE task; no callback is invoked.  The ring must outlive
+ * the registration; unregister with registerForNotify(nullptr).
+ * @param [in] ring The ring to receive the notifications.
+ */
+void BLERemoteCharacteristic::registerForNotify(BLENotificationRing& ring) {
+	ESP_LOGD(LOG_TAG, ">> registerForNotify(ring): %s", toString().c_str());
+	m_notifyCallback    = nullptr;
+	m_pNotificationRing = &ring;
+	registerNotify(true);
+	ESP_LOGD(LOG_TAG, "<< registerForNotify(ring)");
+} // registerForNotify
 
+
+/**
+ * @brief Register, or unregister, for notifications with the %BLE stack and wait for it to complete.
+ * @param [in] enable True to register, false to unregister.
+ */
+void BLERemoteCharacteristic::registerNotify(bool enable) {
 	m_semaphoreRegForNotifyEvt.take("registerForNotify");
+	BLERemoteRequestQueue::Operation operation = enable ?
+		BLERemoteRequestQueue::REGISTER_FOR_NOTIFY : BLERemoteRequestQueue::UNREGISTER_FOR_NOTIFY;
+	if (getRequestQueue()->enqueue(operation, this, nullptr, 0, registerComplete, 0)) {
+		m_semaphoreRegForNotifyEvt.wait("registerForNotify");
+	} else {
+		m_semaphoreRegForNotifyEvt.give();
+		ESP_LOGE(LOG_TAG, "Unable to queue the notification registration");
+	}
+} // registerNotify
 
-	if (notifyCallback != nullptr) {   // If we have a callback function, then this is a registration.
-		esp_err_t errRc = ::esp_ble_gattc_register_for_notify(
-			m_pRemoteService->getClient()->getGattcIf(),
-			*m_pRemoteService->getClient()->getPeerAddress().getNative(),
-			getHandle()
-		);
 
-		if (errRc != ESP_OK) {
-			ESP_LOGE(LOG_TAG, "esp_ble_gattc_register_for_notify: rc=%d %s", errRc, GeneralUtils::errorToString(errRc));
-		}
-	} // End Register
-	else {   // If we weren't passed a callback function, then this is an unregistration.
-		esp_err_t errRc = ::esp_ble_gattc_unregister_for_notify(
-			m_pRemoteService->getClient()->getGattcIf(),
-			*m_pRemoteService->getClient()->getPeerAddress().getNative(),
-			getHandle()
-		);
-
-		if (errRc != ESP_OK) {
-			ESP_LOGE(LOG_TAG, "esp_ble_gattc_unregister_for_notify: rc=%d %s", errRc, GeneralUtils::errorToString(errRc));
-		}
-	} // End Unregister
+/**
+ * @brief Register for notifications without waiting for the registration to complete.
+ * @param [in] notifyCallback A callback to be invoked for a notification.  If NULL is provided then we are
+ * unregistering a notification.
+ * @param [in] callback The function to call with the outcome of the registration.
+ * @param [in] timeoutMs How long the registration may take, counted from now, or 0 to wait for ever.
+ * @return True if the registration was queued.
+ */
+bool BLERemoteCharacteristic::registerForNotifyAsync(
+		void (*notifyCallback)(
+			BLERemoteCharacteristic* pBLERemoteCharacteristic,
+			uint8_t*                 pData,
+			size_t                   length,
+			bool                     isNotify),
+		BLERemoteRequestQueue::Callback callback,
+		uint32_t timeoutMs) {
+	ESP_LOGD(LOG_TAG, ">> registerForNotifyAsync(): %s", toString().c_str());
+	m_notifyCallback    = notifyCallback;   // Save the notification callback.
+	m_pNotificationRing = nullptr;
+	BLERemoteRequestQueue::Operation operation = (notifyCallback != nullptr) ?
+		BLERemoteRequestQueue::REGISTER_FOR_NOTIFY : BLERemoteRequestQueue::UNREGISTER_FOR_NOTIFY;
+	return getRequestQueue()->enqueue(operation, this, nullptr, 0, callback, timeoutMs);
+} // registerForNotifyAsync
 
-	m_semaphoreRegForNotifyEvt.wait("registerForNotify");
 
-	ESP_LOGD(LOG_TAG, "<< registerForNotify()");
-} // registerForNotify
+/**
+ * @brief Completion of a blocking notification registration: release the caller.
+ */
+void BLERemoteCharacteristic::registerComplete(BLERemoteCharacteristic* pCharacteristic, esp_gatt_status_t status, uint8_t* pData, size_t length) {
+	if (status != ESP_GATT_OK) {
+		ESP_LOGE(LOG_TAG, "Notification registration failed: status=%d", status);
+	}
+	pCharacteristic->m_semaphoreRegForNotifyEvt.give();
+} // registerComplete
 
 
 /**
@@ -558,22 +514,13 @@ void BLERemoteCharacteristic::writeValue(std::string newValue, bool response) {
 
 	m_semaphoreWriteCharEvt.take("writeValue");
 
-	// Invoke the ESP-IDF API to perform the write.
-	esp_err_t errRc = ::esp_ble_gattc_write_char(
-		m_pRemoteService->getClient()->getGattcIf(),
-		m_pRemoteService->getClient()->getConnId(),
-		getHandle(),
-		newValue.length(),
-		(uint8_t*)newValue.data(),
-		response?ESP_GATT_WRITE_TYPE_RSP:ESP_GATT_WRITE_TYPE_NO_RSP,
-		ESP_GATT_AUTH_REQ_NONE
-	);
-
-	if (errRc != ESP_OK) {
-		ESP_LOGE(LOG_TAG, "esp_ble_gattc_write_char: rc=%d %s", errRc, GeneralUtils::errorToString(errRc));
+	// Queue the write behind any other request on the connection and block waiting for it to complete.
+	BLERemoteRequestQueue::Operation operation = response ? BLERemoteRequestQueue::WRITE : BLERemoteRequestQueue::WRITE_NO_RESPONSE;
+	if (!getRequestQueue()->enqueue(operation, this, (uint8_t*)newValue.data(), newValue.length(), writeComplete, 0)) {
+		m_semaphoreWriteCharEvt.give();
+		ESP_LOGE(LOG_TAG, "<< writeValue: unable to queue the write");
 		return;
 	}
-
 	m_semaphoreWriteCharEvt.wait("writeValue");
 
 	ESP_LOGD(LOG_TAG, "<< writeValue");
@@ -603,4 +550,134 @@ void BLERemoteCharacteristic::writeValue(uint8_t* data, size_t length, bool resp
 	writeValue(std::string((char *)data, length), response);
 } // writeValue
 
+
+/**
+ * @brief Write the new value for the characteristic without waiting for the write to complete.
+ * The write is sent once the requests queued before it on the connection have completed.  The callback is
+ * invoked on the %BLE task; it must not block.
+ * @param [in] data A pointer to a data buffer.  It is copied.
+ * @param [in] length The length of the data in the data buffer.
+ * @param [in] response Whether we require a response from the write.
+ * @param [in] callback The function to call with the outcome of the write, or nullptr.
+ * @param [in] timeoutMs How long the write may take, counted from now, or 0 to wait for ever.
+ * @return True if the write was queued.
+ */
+bool BLERemoteCharacteristic::writeValueAsync(uint8_t* data, size_t length, bool response, BLERemoteRequestQueue::Callback callback, uint32_t timeoutMs) {
+	ESP_LOGD(LOG_TAG, ">> writeValueAsync(), length: %d", length);
+	BLERemoteRequestQueue::Operation operation = response ? BLERemoteRequestQueue::WRITE : BLERemoteRequestQueue::WRITE_NO_RESPONSE;
+	return getRequestQueue()->enqueue(operation, this, data, length, callback, timeoutMs);
+} // writeValueAsync
+
+
+/**
+ * @brief Write the new value for the characteristic without waiting for the write to complete.
+ * @param [in] newValue The new value to write.
+ * @param [in] response Whether we require a response from the write.
+ * @param [in] callback The function to call with the outcome of the write, or nullptr.
+ * @param [in] timeoutMs How long the write may take, counted from now, or 0 to wait for ever.
+ * @return True if the write was queued.
+ */
+bool BLERemoteCharacteristic::writeValueAsync(std::string newValue, bool response, BLERemoteRequestQueue::Callback callback, uint32_t timeoutMs) {
+	return writeValueAsync((uint8_t*)newValue.data(), newValue.length(), response, callback, timeoutMs);
+} // writeValueAsync
+
+
+/**
+ * @brief Stream a buffer of any length to the characteristic with writes without response.
+ * The buffer is cut into chunks of the largest value that fits the MTU of the connection.  Up to window
+ * chunks are queued at once, so each is sent as soon as the stack has taken the one before it, with no wait
+ * on this task in between; while the stack reports the connection congested, sending pauses.  This returns
+ * once every chunk has been handed to the stack, or a write has failed.
+ * @param [in] data The data to write.
+ * @param [in] length The length of the data.
+ * @param [out] pStats Receives the throughput, or nullptr.
+ * @param [in] window The most chunks queued at once.
+ * @return True if every chunk was written.
+ * @throws BLEDisconnectedException
+ */
+bool BLERemoteCharacteristic::writeStream(const uint8_t* data, size_t length, StreamStats* pStats, uint8_t window) {
+	ESP_LOGD(LOG_TAG, ">> writeStream(), length: %d, window: %d", length, window);
+	BLEClient* pClient = getRemoteService()->getClient();
+	if (!pClient->isConnected()) {
+		ESP_LOGE(LOG_TAG, "Disconnected");
+		throw BLEDisconnectedException();
+	}
+	if (window == 0) {
+		window = 1;
+	}
+	SemaphoreHandle_t credits = ::xSemaphoreCreateCounting(window, window);
+	if (credits == nullptr) {
+		ESP_LOGE(LOG_TAG, "<< writeStream(): unable to create the window");
+		return false;
+	}
+
+	m_semaphoreWriteCharEvt.take("writeStream");   // One writer at a time.
+	m_streamCredits = credits;
+	m_streamStatus  = ESP_GATT_OK;
+
+	size_t   chunkSize = pClient->getMTU() - 3;
+	size_t   offset    = 0;
+	uint32_t chunks    = 0;
+	uint32_t start     = FreeRTOS::getTimeSinceStart();
+	while (offset < length && m_streamStatus == ESP_GATT_OK) {
+		::xSemaphoreTake(credits, portMAX_DELAY);   // Wait for room in the window.
+		size_t size = std::min(chunkSize, length - offset);
+		bool queued;
+		// The queue may be full of other requests on the connection; wait for them to drain.
+		while (!(queued = getRequestQueue()->enqueue(BLERemoteRequestQueue::WRITE_NO_RESPONSE, this, data + offset, size, streamComplete, 0)) &&
+				pClient->isConnected()) {
+			FreeRTOS::sleep(1);
+		}
+		if (!queued) {
+			m_streamStatus = BLERemoteRequestQueue::STATUS_DISCONNECTED;
+			::xSemaphoreGive(credits);
+			break;
+		}
+		offset += size;
+		chunks++;
+	}
+	for (uint8_t i = 0; i < window; i++) {
+		::xSemaphoreTake(credits, portMAX_DELAY);   // Wait for the chunks still outstanding.
+	}
+	uint32_t elapsedMs = FreeRTOS::getTimeSinceStart() - start;
+	esp_gatt_status_t status = m_streamStatus;
+
+	m_streamCredits = nullptr;
+	::vSemaphoreDelete(credits);
+	m_semaphoreWriteCharEvt.give();
+
+	if (pStats != nullptr) {
+		pStats->bytes          = offset;
+		pStats->chunks         = chunks;
+		pStats->elapsedMs      = elapsedMs;
+		pStats->bytesPerSecond = elapsedMs == 0 ? 0 : (uint32_t)((uint64_t)offset * 1000 / elapsedMs);
+	}
+	ESP_LOGD(LOG_TAG, "<< writeStream(): %d bytes in %d chunks, %d ms, status=%d", offset, chunks, elapsedMs, status);
+	return status == ESP_GATT_OK;
+} // writeStream
+
+
+/**
+ * @brief Completion of a writeStream() write: return its credit to the window.
+ */
+void BLERemoteCharacteristic::streamComplete(BLERemoteCharacteristic* pCharacteristic, esp_gatt_status_t status, uint8_t* pData, size_t length) {
+	// A write command reported congested has still been taken by the stack; the congestion event pauses the queue.
+	if (status != ESP_GATT_OK && status != ESP_GATT_CONGESTED && pCharacteristic->m_streamStatus == ESP_GATT_OK) {
+		ESP_LOGE(LOG_TAG, "Stream write failed: status=%d", status);
+		pCharacteristic->m_streamStatus = status;
+	}
+	::xSemaphoreGive(pCharacteristic->m_streamCredits);
+} // streamComplete
+
+
+/**
+ * @brief Completion of a blocking write: release the writer.
+ */
+void BLERemoteCharacteristic::writeComplete(BLERemoteCharacteristic* pCharacteristic, esp_gatt_status_t status, uint8_t* pData, size_t length) {
+	if (status != ESP_GATT_OK) {
+		ESP_LOGE(LOG_TAG, "Write failed: status=%d", status);
+	}
+	pCharacteristic->m_semaphoreWriteCharEvt.give();
+} // writeComplete
+
 #endif /* CONFIG_BT_ENABLED */
@@ -11,11 +11,14 @@
 #if defined(CONFIG_BT_ENABLED)
 
 #include <string>
+#include <type_traits>
 
 #include <esp_gattc_api.h>
 
+#include "BLENotificationRing.h"
 #include "BLERemoteService.h"
 #include "BLERemoteDescriptor.h"
+#include "BLERemoteRequestQueue.h"
 #include "BLEUUID.h"
 #include "FreeRTOS.h"
 
@@ -27,6 +30,16 @@ class BLERemoteDescriptor;
  */
 class BLERemoteCharacteristic {
 public:
+	/**
+	 * @brief The throughput of a writeStream().
+	 */
+	struct StreamStats {
+		size_t   bytes;            // The bytes queued for writing; all were written if writeStream() succeeded.
+		uint32_t chunks;           // The writes they were sent in.
+		uint32_t elapsedMs;
+		uint32_t bytesPerSecond;
+	};
+
 	~BLERemoteCharacteristic();
 
 	// Public member functions
@@ -40,21 +53,44 @@ public:
 	std::map<std::string, BLERemoteDescriptor *>* getDescriptors();
 	uint16_t    getHandle();
 	BLEUUID     getUUID();
+	uint16_t    readInto(uint8_t* pBuffer, uint16_t capacity);
 	std::string readValue(void);
+	bool        readValueAsync(BLERemoteRequestQueue::Callback callback, uint32_t timeoutMs = 30000);
 	uint8_t     readUInt8(void);
 	uint16_t    readUInt16(void);
 	uint32_t    readUInt32(void);
 	void        registerForNotify(void (*notifyCallback)(BLERemoteCharacteristic* pBLERemoteCharacteristic, uint8_t* pData, size_t length, bool isNotify));
+	void        registerForNotify(BLENotificationRing& ring);
+	bool        registerForNotifyAsync(void (*notifyCallback)(BLERemoteCharacteristic* pBLERemoteCharacteristic, uint8_t* pData, size_t length, bool isNotify),
+	                                   BLERemoteRequestQueue::Callback callback, uint32_t timeoutMs = 30000);
 	void        writeValue(uint8_t* data, size_t length, bool response = false);
 	void        writeValue(std::string newValue, bool response = false);
 	void        writeValue(uint8_t newValue, bool response = false);
+	bool        writeValueAsync(uint8_t* data, size_t length, bool response, BLERemoteRequestQueue::Callback callback, uint32_t timeoutMs = 30000);
+	bool        writeValueAsync(std::string newValue, bool response, BLERemoteRequestQueue::Callback callback, uint32_t timeoutMs = 30000);
+	bool        writeStream(const uint8_t* data, size_t length, StreamStats* pStats = nullptr, uint8_t window = 4);
 	std::string toString(void);
 
+	/**
+	 * @brief Read the value of the remote characteristic as a T.
+	 * The value is copied straight from the response into the result, with no intermediate string.
+	 * @return The value, or T() if the value read is shorter than a T.
+	 */
+	template<typename T> T read() {
+		static_assert(std::is_trivially_copyable<T>::value, "read<T>() needs a trivially copyable type");
+		T value;
+		if (readInto((uint8_t*)&value, sizeof(T)) < sizeof(T)) {
+			return T();
+		}
+		return value;
+	} // read
+
 private:
 	BLERemoteCharacteristic(uint16_t handle, BLEUUID uuid, esp_gatt_char_prop_t charProp, BLERemoteService* pRemoteService);
 	friend class BLEClient;
 	friend class BLERemoteService;
 	friend class BLERemoteDescriptor;
+	friend class BLEDiscoveryCache;
 
 	// Private member functions
 	void gattClientEventHandler(
@@ -64,8 +100,14 @@ private:
 
 
 	BLERemoteService* getRemoteService();
+	BLERemoteRequestQueue* getRequestQueue();
+	void              registerNotify(bool enable);
 	void              removeDescriptors();
-	void              retrieveDescriptors();
+
+	static void readComplete(BLERemoteCharacteristic* pCharacteristic, esp_gatt_status_t status, uint8_t* pData, size_t length);
+	static void registerComplete(BLERemoteCharacteristic* pCharacteristic, esp_gatt_status_t status, uint8_t* pData, size_t length);
+	static void streamComplete(BLERemoteCharacteristic* pCharacteristic, esp_gatt_status_t status, uint8_t* pData, size_t length);
+	static void writeComplete(BLERemoteCharacteristic* pCharacteristic, esp_gatt_status_t status, uint8_t* pData, size_t length);
 
 	// Private properties
 	BLEUUID              m_uuid;
@@ -77,6 +119,9 @@ private:
 	FreeRTOS::Semaphore  m_semaphoreWriteCharEvt     = FreeRTOS::Semaphore("WriteCharEvt");
 	std::string          m_value;
   void (*m_notifyCallback)(BLERemoteCharacteristic* pBLERemoteCharacteristic, uint8_t* pData, size_t length, bool isNotify);
+	BLENotificationRing* m_pNotificationRing;
+	SemaphoreHandle_t    m_streamCredits;             // One per write a writeStream() may have outstanding.
+	volatile esp_gatt_status_t m_streamStatus;        // The first failure of a writeStream() write.
 
 	// We maintain a map of descriptors owned by this characteristic keyed by a string representation of the UUID.
 	std::map<std::string, BLERemoteDescriptor*> m_descriptorMap;
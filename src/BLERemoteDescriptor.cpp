@@ -7,6 +7,7 @@
 #include "sdkconfig.h"
 #if defined(CONFIG_BT_ENABLED)
 #include <sstream>
+#include <string.h>
 #include "BLERemoteDescriptor.h"
 #include "GeneralUtils.h"
 #include <esp_log.h>
@@ -98,19 +99,21 @@ uint8_t BLERemoteDescriptor::readUInt8(void) {
 
 uint16_t BLERemoteDescriptor::readUInt16(void) {
 	std::string value = readValue();
+	uint16_t result = 0;
 	if (value.length() >= 2) {
-		return *(uint16_t*)(value.data());
+		memcpy(&result, value.data(), sizeof(result));   // The data of the string need not be aligned.
 	}
-	return 0;
+	return result;
 } // readUInt16
 
 
 uint32_t BLERemoteDescriptor::readUInt32(void) {
 	std::string value = readValue();
+	uint32_t result = 0;
 	if (value.length() >= 4) {
-		return *(uint32_t*)(value.data());
+		memcpy(&result, value.data(), sizeof(result));   // The data of the string need not be aligned.
 	}
-	return 0;
+	return result;
 } // readUInt32
 
 
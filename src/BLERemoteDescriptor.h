@@ -38,6 +38,8 @@ public:
 
 private:
 	friend class BLERemoteCharacteristic;
+	friend class BLEDiscoveryCache;
+	friend class BLERemoteService;
 	BLERemoteDescriptor(
 		uint16_t                 handle,
 		BLEUUID                  uuid,
@@ -0,0 +1,488 @@
+/*
+ * BLERemoteRequestQueue.cpp
+ *
+ *  Created on: Oct 19, 2026
+ */
+#include "sdkconfig.h"
+#if defined(CONFIG_BT_ENABLED)
+#include <esp_log.h>
+#include <string.h>
+#include "BLERemoteRequestQueue.h"
+#include "BLEClient.h"
+#include "BLERemoteCharacteristic.h"
+#include "GeneralUtils.h"
+#ifdef ARDUINO_ARCH_ESP32
+#include "esp32-hal-log.h"
+#endif
+
+static const char* LOG_TAG = "BLERemoteRequestQueue";
+
+static const uint8_t  DEFAULT_MAX_QUEUED = 16;
+static const uint32_t CHECK_PERIOD_MS    = 100;   // How often requests are checked for a timeout.
+
+const esp_gatt_status_t BLERemoteRequestQueue::STATUS_TIMEOUT;
+const esp_gatt_status_t BLERemoteRequestQueue::STATUS_DISCONNECTED;
+
+
+/**
+ * @brief Get the event that completes an operation.
+ * @param [in] operation The operation.
+ * @return The event.
+ */
+static esp_gattc_cb_event_t completionEvent(BLERemoteRequestQueue::Operation operation) {
+	switch(operation) {
+		case BLERemoteRequestQueue::READ:                  return ESP_GATTC_READ_CHAR_EVT;
+		case BLERemoteRequestQueue::READ_MULTIPLE:         return ESP_GATTC_READ_MULTIPLE_EVT;
+		case BLERemoteRequestQueue::REGISTER_FOR_NOTIFY:   return ESP_GATTC_REG_FOR_NOTIFY_EVT;
+		case BLERemoteRequestQueue::UNREGISTER_FOR_NOTIFY: return ESP_GATTC_UNREG_FOR_NOTIFY_EVT;
+		default:                                           return ESP_GATTC_WRITE_CHAR_EVT;
+	}
+} // completionEvent
+
+
+/**
+ * @brief Create the queue of a client.
+ * @param [in] pClient The client whose connection the requests are sent on.
+ */
+BLERemoteRequestQueue::BLERemoteRequestQueue(BLEClient* pClient) {
+	m_pClient   = pClient;
+	m_inFlight  = false;
+	m_congested = false;
+	m_maxQueued = DEFAULT_MAX_QUEUED;
+	m_timer     = nullptr;
+	m_timerRunning = false;
+} // BLERemoteRequestQueue
+
+
+BLERemoteRequestQueue::~BLERemoteRequestQueue() {
+	if (m_timer != nullptr) {
+		::xTimerDelete(m_timer, portMAX_DELAY);
+	}
+} // ~BLERemoteRequestQueue
+
+
+/**
+ * @brief Handle the completion of a request.
+ * The next request in the queue, if any, is sent before the callback of the completed one is invoked.
+ * @param [in] event The event that reported the completion.
+ * @param [in] handle The handle of the characteristic in the event.
+ * @param [in] status The status in the event.
+ * @param [in] pData The value read, for a read.
+ * @param [in] length The length of the value read.
+ */
+void BLERemoteRequestQueue::complete(esp_gattc_cb_event_t event, uint16_t handle, esp_gatt_status_t status, uint8_t* pData, size_t length) {
+	std::vector<Outcome> outcomes;
+	m_semaphoreQueue.take("complete");
+	// The handle reported for a Read Multiple is not that of any one characteristic.
+	if (!m_inFlight || completionEvent(m_queue.front().operation) != event ||
+			(event != ESP_GATTC_READ_MULTIPLE_EVT && m_queue.front().pCharacteristic->getHandle() != handle)) {
+		m_semaphoreQueue.give();
+		ESP_LOGD(LOG_TAG, "No request in flight for event %d on handle %d", event, handle);
+		return;
+	}
+	Request request = m_queue.front();
+	m_queue.pop_front();
+	m_inFlight = false;
+	if (request.operation == READ_MULTIPLE && status == ESP_GATT_REQ_NOT_SUPPORTED) {
+		// The server cannot read several values at once; read them one by one, ahead of everything else.
+		ESP_LOGD(LOG_TAG, "Read Multiple not supported, reading %d values one by one", request.slots.size());
+		request.pBatch->remaining += request.slots.size() - 1;
+		for (auto it = request.slots.rbegin(); it != request.slots.rend(); ++it) {
+			Request read = request;
+			read.operation       = READ;
+			read.pCharacteristic = it->pCharacteristic;
+			read.slot            = *it;
+			read.slots.clear();
+			m_queue.push_front(read);
+		}
+		sendNext(outcomes);
+		m_semaphoreQueue.give();
+		report(outcomes);
+		return;
+	}
+	if (request.pBatch != nullptr) {
+		fill(request, status, pData, length);
+	}
+	sendNext(outcomes);
+	m_semaphoreQueue.give();
+
+	if (!request.abandoned && request.callback != nullptr) {
+		request.callback(request.pCharacteristic, status, pData, length);
+	}
+	report(outcomes);
+} // complete
+
+
+/**
+ * @brief Queue a request.
+ * @param [in] operation The operation.
+ * @param [in] pCharacteristic The characteristic to operate on.
+ * @param [in] pData The value to write, for a write.  It is copied.
+ * @param [in] length The length of the value to write.
+ * @param [in] callback The function to call with the outcome, or nullptr.
+ * @param [in] timeoutMs How long the request may take, counted from now, or 0 to wait for ever.
+ * @return True if the request was queued, false if the queue is full or a read or write was requested
+ * without a connection.
+ */
+bool BLERemoteRequestQueue::enqueue(Operation operation, BLERemoteCharacteristic* pCharacteristic, const uint8_t* pData, size_t length,
+		Callback callback, uint32_t timeoutMs) {
+	if (operation != REGISTER_FOR_NOTIFY && operation != UNREGISTER_FOR_NOTIFY && !m_pClient->isConnected()) {
+		ESP_LOGD(LOG_TAG, "<< enqueue: not connected");
+		return false;
+	}
+	std::vector<Outcome> outcomes;
+	m_semaphoreQueue.take("enqueue");
+	if (m_queue.size() >= m_maxQueued) {
+		m_semaphoreQueue.give();
+		ESP_LOGD(LOG_TAG, "<< enqueue: %d requests already queued", m_queue.size());
+		return false;
+	}
+	if (timeoutMs != 0 && m_timer == nullptr) {
+		m_timer = ::xTimerCreate("requestTimeout", CHECK_PERIOD_MS / portTICK_PERIOD_MS, pdTRUE, this, timerCallback);
+	}
+	Request request;
+	request.operation       = operation;
+	request.pCharacteristic = pCharacteristic;
+	request.value.assign((const char*)pData, pData == nullptr ? 0 : length);
+	request.callback        = callback;
+	request.timeoutMs       = timeoutMs;
+	request.queuedAt        = ::xTaskGetTickCount();
+	request.abandoned       = false;
+	request.pBatch          = nullptr;
+	m_queue.push_back(request);
+	sendNext(outcomes);
+	// Tracked under the lock rather than asked of the timer: a stop issued by checkTimeouts() only takes
+	// effect once the callback returns, and until then the timer still looks active.
+	if (timeoutMs != 0 && m_timer != nullptr && !m_timerRunning) {
+		::xTimerStart(m_timer, 0);
+		m_timerRunning = true;
+	}
+	m_semaphoreQueue.give();
+	report(outcomes);
+	return true;
+} // enqueue
+
+
+/**
+ * @brief Queue a read that copies the value straight into the caller's buffer.
+ * Unlike enqueue(), the request holds no copy of any value.  It is not limited by setMaxQueued(), since the caller
+ * is blocked until it completes.  Take the semaphore of the batch before calling and wait with waitReads().
+ * @param [in] pBatch The batch the read belongs to.
+ * @param [in] slot The characteristic to read and where its value goes.
+ */
+void BLERemoteRequestQueue::enqueueRead(Batch* pBatch, const Slot& slot) {
+	std::vector<Outcome> outcomes;
+	Request request;
+	request.operation       = READ;
+	request.pCharacteristic = slot.pCharacteristic;
+	request.slot            = slot;
+	request.pBatch          = pBatch;
+
+	m_semaphoreQueue.take("enqueueRead");
+	pBatch->remaining++;
+	pushRead(request);
+	sendNext(outcomes);
+	m_semaphoreQueue.give();
+	report(outcomes);
+} // enqueueRead
+
+
+/**
+ * @brief Queue reads that copy values straight into the caller's buffers.
+ * The reads are queued together, so they are sent back to back with no wait on the caller between them.
+ * They are not limited by setMaxQueued(), since the caller is blocked until they complete.  The semaphore
+ * of the batch is given when all of them have completed; take it before calling and wait with waitReads().
+ * @param [in] pBatch The batch the reads belong to.
+ * @param [in] slots The characteristics to read and where their values go.
+ * @param [in] groups The number of slots read by each request, in order.  A group of more than one slot is
+ * read with a single Read Multiple request; the size of each of its slots must then be the exact size of the
+ * value, since the response does not separate the values.
+ */
+void BLERemoteRequestQueue::enqueueReads(Batch* pBatch, const std::vector<Slot>& slots, const std::vector<uint8_t>& groups) {
+	std::vector<Outcome> outcomes;
+	Request request;
+	request.pBatch = pBatch;
+
+	m_semaphoreQueue.take("enqueueReads");
+	size_t first = 0;
+	for (auto count : groups) {
+		request.pCharacteristic = slots[first].pCharacteristic;
+		if (count > 1) {
+			request.operation = READ_MULTIPLE;
+			request.slots.assign(slots.begin() + first, slots.begin() + first + count);
+		} else {
+			request.operation = READ;
+			request.slot      = slots[first];
+			request.slots.clear();
+		}
+		pBatch->remaining++;
+		pushRead(request);
+		first += count;
+	}
+	sendNext(outcomes);
+	m_semaphoreQueue.give();
+	report(outcomes);
+} // enqueueReads
+
+
+/**
+ * @brief Fail a request that will not be answered.
+ * @param [in] request The request.
+ * @param [in] status The status to report.
+ * @param [out] outcomes The outcome to report to a callback is added here.
+ */
+void BLERemoteRequestQueue::fail(Request& request, esp_gatt_status_t status, std::vector<Outcome>& outcomes) {
+	if (request.pBatch != nullptr) {
+		fill(request, status, nullptr, 0);
+		return;
+	}
+	if (request.abandoned) {
+		return;   // Already reported.
+	}
+	Outcome outcome;
+	outcome.pCharacteristic = request.pCharacteristic;
+	outcome.callback        = request.callback;
+	outcome.status          = status;
+	outcomes.push_back(outcome);
+} // fail
+
+
+/**
+ * @brief Copy the value, or values, of a completed read into the buffers of its slots.
+ * A value longer than its buffer is truncated.  When the last read of the batch has completed the waiting
+ * caller is released, after which the batch must not be touched.
+ * @param [in] request The read.
+ * @param [in] status The status of the read.
+ * @param [in] pData The value, or for a Read Multiple the values one after the other.
+ * @param [in] length The length of the data.
+ */
+void BLERemoteRequestQueue::fill(Request& request, esp_gatt_status_t status, uint8_t* pData, size_t length) {
+	Slot*  pSlots = &request.slot;
+	size_t count  = 1;
+	if (request.operation == READ_MULTIPLE) {
+		pSlots = request.slots.data();
+		count  = request.slots.size();
+	}
+	size_t offset = 0;
+	for (size_t i = 0; i < count; i++) {
+		uint16_t copied = 0;
+		if (status == ESP_GATT_OK && offset < length) {
+			copied = (length - offset < pSlots[i].size) ? (uint16_t)(length - offset) : pSlots[i].size;
+			memcpy(pSlots[i].pBuffer, pData + offset, copied);
+		}
+		*pSlots[i].pLength = copied;
+		offset += pSlots[i].size;
+	}
+	Batch* pBatch = request.pBatch;
+	if (status != ESP_GATT_OK) {
+		pBatch->status = status;
+	}
+	if (--pBatch->remaining == 0) {
+		pBatch->pSemaphore->give();
+	}
+} // fill
+
+
+/**
+ * @brief Discard every request.
+ * Used when the connection is closed, or the characteristics are about to be deleted; each request not
+ * already reported is reported with STATUS_DISCONNECTED.
+ */
+void BLERemoteRequestQueue::release() {
+	std::vector<Outcome> outcomes;
+	m_semaphoreQueue.take("release");
+	for (auto &request : m_queue) {
+		fail(request, STATUS_DISCONNECTED, outcomes);
+	}
+	m_queue.clear();
+	m_inFlight  = false;
+	m_congested = false;
+	m_semaphoreQueue.give();
+	report(outcomes);
+} // release
+
+
+/**
+ * @brief Send the request at the head of the queue, if none is in flight.
+ * @param [out] outcomes Requests that could not be sent are added here.
+ */
+void BLERemoteRequestQueue::sendNext(std::vector<Outcome>& outcomes) {
+	while (!m_inFlight && !m_congested && !m_queue.empty()) {
+		Request& request = m_queue.front();
+		esp_err_t errRc;
+		switch(request.operation) {
+			case READ: {
+				errRc = ::esp_ble_gattc_read_char(
+					m_pClient->getGattcIf(),
+					m_pClient->getConnId(),
+					request.pCharacteristic->getHandle(),
+					ESP_GATT_AUTH_REQ_NONE);
+				break;
+			}
+			case READ_MULTIPLE: {
+				esp_gattc_multi_t multi;
+				multi.num_attr = request.slots.size();
+				for (size_t i = 0; i < request.slots.size(); i++) {
+					multi.handles[i] = request.slots[i].pCharacteristic->getHandle();
+				}
+				errRc = ::esp_ble_gattc_read_multiple(
+					m_pClient->getGattcIf(),
+					m_pClient->getConnId(),
+					&multi,
+					ESP_GATT_AUTH_REQ_NONE);
+				break;
+			}
+			case WRITE:
+			case WRITE_NO_RESPONSE: {
+				errRc = ::esp_ble_gattc_write_char(
+					m_pClient->getGattcIf(),
+					m_pClient->getConnId(),
+					request.pCharacteristic->getHandle(),
+					request.value.length(),
+					(uint8_t*)request.value.data(),
+					request.operation == WRITE ? ESP_GATT_WRITE_TYPE_RSP : ESP_GATT_WRITE_TYPE_NO_RSP,
+					ESP_GATT_AUTH_REQ_NONE);
+				break;
+			}
+			case REGISTER_FOR_NOTIFY: {
+				errRc = ::esp_ble_gattc_register_for_notify(
+					m_pClient->getGattcIf(),
+					*m_pClient->getPeerAddress().getNative(),
+					request.pCharacteristic->getHandle());
+				break;
+			}
+			default: {
+				errRc = ::esp_ble_gattc_unregister_for_notify(
+					m_pClient->getGattcIf(),
+					*m_pClient->getPeerAddress().getNative(),
+					request.pCharacteristic->getHandle());
+				break;
+			}
+		} // switch
+		if (errRc == ESP_OK) {
+			m_inFlight = true;
+			return;
+		}
+		ESP_LOGE(LOG_TAG, "Request %d on handle %d: rc=%d %s", request.operation, request.pCharacteristic->getHandle(),
+			errRc, GeneralUtils::errorToString(errRc));
+		fail(request, ESP_GATT_ERROR, outcomes);
+		m_queue.pop_front();
+	}
+} // sendNext
+
+
+/**
+ * @brief Pause or resume sending as the stack reports the congestion of the connection.
+ * While congested, requests are held in the queue rather than piled onto the stack's own buffers; the one
+ * in flight, if any, still completes.
+ * @param [in] congested True if the connection is congested.
+ */
+void BLERemoteRequestQueue::setCongested(bool congested) {
+	std::vector<Outcome> outcomes;
+	m_semaphoreQueue.take("setCongested");
+	ESP_LOGD(LOG_TAG, "Connection %s", congested ? "congested" : "no longer congested");
+	m_congested = congested;
+	sendNext(outcomes);
+	m_semaphoreQueue.give();
+	report(outcomes);
+} // setCongested
+
+
+/**
+ * @brief Set the most requests that may be queued, including the one in flight.
+ * @param [in] maxQueued The maximum number of requests.
+ */
+void BLERemoteRequestQueue::setMaxQueued(uint8_t maxQueued) {
+	m_semaphoreQueue.take("setMaxQueued");
+	m_maxQueued = maxQueued;
+	m_semaphoreQueue.give();
+} // setMaxQueued
+
+
+/**
+ * @brief Wait for the reads of a batch queued with enqueueReads() to complete.
+ * @param [in] pBatch The batch.  It may be destroyed once this returns.
+ */
+void BLERemoteRequestQueue::waitReads(Batch* pBatch) {
+	pBatch->pSemaphore->wait("waitReads");
+	// The batch is released with the queue locked; once we hold the lock, nothing touches the batch any more.
+	m_semaphoreQueue.take("waitReads");
+	m_semaphoreQueue.give();
+} // waitReads
+
+
+/**
+ * @brief Fail the requests that have not completed in time.
+ * A request that is waiting is removed.  One that is in flight stays at the head of the queue, since ATT
+ * allows no other request until it has been answered.
+ */
+void BLERemoteRequestQueue::checkTimeouts() {
+	std::vector<Outcome> outcomes;
+	bool pending = false;
+	m_semaphoreQueue.take("checkTimeouts");
+	TickType_t now = ::xTaskGetTickCount();
+	for (auto it = m_queue.begin(); it != m_queue.end(); ) {
+		if (it->timeoutMs == 0 || it->abandoned) {
+			++it;
+			continue;
+		}
+		if ((now - it->queuedAt) * portTICK_PERIOD_MS < it->timeoutMs) {
+			pending = true;
+			++it;
+			continue;
+		}
+		ESP_LOGE(LOG_TAG, "Request %d on handle %d timed out", it->operation, it->pCharacteristic->getHandle());
+		fail(*it, STATUS_TIMEOUT, outcomes);
+		if (m_inFlight && it == m_queue.begin()) {
+			it->abandoned = true;
+			++it;
+		} else {
+			it = m_queue.erase(it);
+		}
+	}
+	if (!pending) {
+		::xTimerStop(m_timer, 0);
+		m_timerRunning = false;
+	}
+	m_semaphoreQueue.give();
+	report(outcomes);
+} // checkTimeouts
+
+
+/**
+ * @brief Add a read into buffers to the back of the queue.
+ * Called with the queue locked.
+ * @param [in] request The read; its operation, characteristic, slots and batch are already set.
+ */
+void BLERemoteRequestQueue::pushRead(Request& request) {
+	request.callback  = nullptr;
+	request.timeoutMs = 0;
+	request.queuedAt  = ::xTaskGetTickCount();
+	request.abandoned = false;
+	m_queue.push_back(request);
+} // pushRead
+
+
+/**
+ * @brief Report the failure of requests to their callbacks.
+ * This is called without the queue locked so that a callback may queue further requests.
+ * @param [in] outcomes The outcomes to report.
+ */
+void BLERemoteRequestQueue::report(std::vector<Outcome>& outcomes) {
+	for (auto &outcome : outcomes) {
+		if (outcome.callback != nullptr) {
+			outcome.callback(outcome.pCharacteristic, outcome.status, nullptr, 0);
+		}
+	}
+} // report
+
+
+/**
+ * @brief Timer callback that checks for requests that have timed out.
+ * @param [in] timer The timer that expired; its ID is the queue.
+ */
+void BLERemoteRequestQueue::timerCallback(TimerHandle_t timer) {
+	((BLERemoteRequestQueue*)::pvTimerGetTimerID(timer))->checkTimeouts();
+} // timerCallback
+
+#endif /* CONFIG_BT_ENABLED */
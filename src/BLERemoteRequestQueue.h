@@ -0,0 +1,125 @@
+/*
+ * BLERemoteRequestQueue.h
+ *
+ *  Created on: Oct 19, 2026
+ */
+
+#ifndef COMPONENTS_CPP_UTILS_BLEREMOTEREQUESTQUEUE_H_
+#define COMPONENTS_CPP_UTILS_BLEREMOTEREQUESTQUEUE_H_
+#include "sdkconfig.h"
+#if defined(CONFIG_BT_ENABLED)
+#include <esp_gattc_api.h>
+#include <deque>
+#include <string>
+#include <vector>
+#include "FreeRTOS.h"
+#include <freertos/timers.h>
+
+class BLEClient;
+class BLERemoteCharacteristic;
+
+/**
+ * @brief The requests of a client waiting to be sent, or answered, on its connection.
+ *
+ * ATT allows a single outstanding request per connection, and Bluedroid rejects a request made while another
+ * is outstanding.  Every read, write and notification registration of a client's characteristics, blocking or
+ * not, is therefore queued here and sent once the one before it has completed.  Each client has its own
+ * queue, so requests on different connections proceed in parallel.
+ *
+ * The outcome of a request is reported to its callback on the %BLE task.  A callback must not block, nor
+ * make a blocking request of its own, since the completion it would wait for is delivered on the same task.
+ * A request that is not answered within its timeout is reported with STATUS_TIMEOUT; if it had already been
+ * sent, the requests behind it wait until its late answer arrives or the connection is closed.  While the
+ * stack reports the connection congested, no further request is sent.
+ */
+class BLERemoteRequestQueue {
+public:
+	typedef void (*Callback)(BLERemoteCharacteristic* pCharacteristic, esp_gatt_status_t status, uint8_t* pData, size_t length);
+
+	enum Operation {
+		READ,
+		READ_MULTIPLE,
+		WRITE,
+		WRITE_NO_RESPONSE,
+		REGISTER_FOR_NOTIFY,
+		UNREGISTER_FOR_NOTIFY
+	};
+
+	static const esp_gatt_status_t STATUS_TIMEOUT      = ESP_GATT_CANCEL;        // Not answered within its timeout.
+	static const esp_gatt_status_t STATUS_DISCONNECTED = ESP_GATT_WRONG_STATE;   // The connection closed first.
+
+	/**
+	 * @brief Where a read copies the value of a characteristic.
+	 */
+	struct Slot {
+		BLERemoteCharacteristic* pCharacteristic;
+		uint8_t*                 pBuffer;
+		uint16_t                 size;       // The size of pBuffer; for Read Multiple, the exact size of the value.
+		uint16_t*                pLength;    // Receives the length copied, 0 if the read failed.
+	};
+
+	/**
+	 * @brief A set of reads whose values are copied into buffers, completed together.
+	 */
+	struct Batch {
+		FreeRTOS::Semaphore* pSemaphore;                  // Given when every read has completed.
+		uint16_t             remaining = 0;
+		esp_gatt_status_t    status    = ESP_GATT_OK;   // The status of the last read to fail.
+	};
+
+	BLERemoteRequestQueue(BLEClient* pClient);
+	~BLERemoteRequestQueue();
+
+	void complete(esp_gattc_cb_event_t event, uint16_t handle, esp_gatt_status_t status, uint8_t* pData, size_t length);
+	bool enqueue(Operation operation, BLERemoteCharacteristic* pCharacteristic, const uint8_t* pData, size_t length,
+	             Callback callback, uint32_t timeoutMs);
+	void enqueueRead(Batch* pBatch, const Slot& slot);
+	void enqueueReads(Batch* pBatch, const std::vector<Slot>& slots, const std::vector<uint8_t>& groups);
+	void release();
+	void setCongested(bool congested);
+	void setMaxQueued(uint8_t maxQueued);
+	void waitReads(Batch* pBatch);
+
+private:
+	struct Request {
+		Operation                operation;
+		BLERemoteCharacteristic* pCharacteristic;
+		std::string              value;        // The value to write.
+		Callback                 callback;
+		uint32_t                 timeoutMs;    // 0 to wait for ever.
+		TickType_t               queuedAt;
+		bool                     abandoned;    // Reported as timed out while in flight; its answer is still awaited.
+		Slot                     slot;         // For a read into a buffer: where the value goes.
+		std::vector<Slot>        slots;        // For a Read Multiple into buffers: where the values go.
+		Batch*                   pBatch;       // For a read into buffers: the batch it belongs to.
+	};
+
+	struct Outcome {
+		BLERemoteCharacteristic* pCharacteristic;
+		Callback                 callback;
+		esp_gatt_status_t        status;
+	};
+
+	BLERemoteRequestQueue(const BLERemoteRequestQueue&) = delete;
+	BLERemoteRequestQueue& operator=(const BLERemoteRequestQueue&) = delete;
+
+	void        checkTimeouts();
+	void        pushRead(Request& request);
+	void        fail(Request& request, esp_gatt_status_t status, std::vector<Outcome>& outcomes);
+	static void fill(Request& request, esp_gatt_status_t status, uint8_t* pData, size_t length);
+	void        sendNext(std::vector<Outcome>& outcomes);
+	static void report(std::vector<Outcome>& outcomes);
+	static void timerCallback(TimerHandle_t timer);
+
+	BLEClient*          m_pClient;
+	std::deque<Request> m_queue;            // The front request is in flight when m_inFlight is set.
+	bool                m_inFlight;
+	bool                m_congested;        // Set while the stack reports the connection congested.
+	uint8_t             m_maxQueued;
+	TimerHandle_t       m_timer;
+	bool                m_timerRunning;     // The timer has been started and not stopped, under the lock.
+	FreeRTOS::Semaphore m_semaphoreQueue = FreeRTOS::Semaphore("RequestQueue");
+}; // BLERemoteRequestQueue
+
+#endif /* CONFIG_BT_ENABLED */
+#endif /* COMPONENTS_CPP_UTILS_BLEREMOTEREQUESTQUEUE_H_ */
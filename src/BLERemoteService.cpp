@@ -8,6 +8,7 @@
 #if defined(CONFIG_BT_ENABLED)
 
 #include <sstream>
+#include <vector>
 #include "BLERemoteService.h"
 #include "BLEUtils.h"
 #include "GeneralUtils.h"
@@ -160,6 +161,10 @@ BLERemoteCharacteristic* BLERemoteService::getCharacteristic(BLEUUID uuid) {
 /**
  * @brief Retrieve all the characteristics for this service.
  * This function will not return until we have all the characteristics.
+ *
+ * The characteristics and their descriptors are copied from the database held by the %BLE stack in a single
+ * call, into a buffer that the client reuses for each of its services.  The stack lists each characteristic
+ * followed by its descriptors, so both are built in one pass over the buffer.
  * @return N/A
  */
 void BLERemoteService::retrieveCharacteristics() {
@@ -168,50 +173,68 @@ void BLERemoteService::retrieveCharacteristics() {
 
 	removeCharacteristics(); // Forget any previous characteristics.
 
-	uint16_t offset = 0;
-	esp_gattc_char_elem_t result;
-	while(1) {
-		uint16_t count = 1;
-		esp_gatt_status_t status = ::esp_ble_gattc_get_all_char(
+	uint16_t count = 0;
+	esp_gatt_status_t status = ::esp_ble_gattc_get_attr_count(
+		getClient()->getGattcIf(),
+		getClient()->getConnId(),
+		ESP_GATT_DB_ALL,
+		m_startHandle,
+		m_endHandle,
+		0,
+		&count
+	);
+	if (status != ESP_GATT_OK) {
+		ESP_LOGE(LOG_TAG, "esp_ble_gattc_get_attr_count: %s", BLEUtils::gattStatusToString(status).c_str());
+		return;
+	}
+
+	std::vector<esp_gattc_db_elem_t>& db = getClient()->m_dbBuffer;
+	if (db.size() < count) {
+		db.resize(count);
+	}
+	if (count > 0) {
+		status = ::esp_ble_gattc_get_db(
 			getClient()->getGattcIf(),
 			getClient()->getConnId(),
 			m_startHandle,
 			m_endHandle,
-			&result,
-			&count,
-			offset
+			db.data(),
+			&count
 		);
-
-		if (status == ESP_GATT_INVALID_OFFSET) {   // We have reached the end of the entries.
-			break;
-		}
-
-		if (status != ESP_GATT_OK) {   // If we got an error, end.
-			ESP_LOGE(LOG_TAG, "esp_ble_gattc_get_all_char: %s", BLEUtils::gattStatusToString(status).c_str());
-			break;
+		if (status != ESP_GATT_OK) {
+			ESP_LOGE(LOG_TAG, "esp_ble_gattc_get_db: %s", BLEUtils::gattStatusToString(status).c_str());
+			return;
 		}
+	}
 
-		if (count == 0) {   // If we failed to get any new records, end.
-			break;
+	BLERemoteCharacteristic* pCharacteristic = nullptr;
+	for (uint16_t i = 0; i < count; i++) {
+		esp_gattc_db_elem_t& elem = db[i];
+		if (elem.type == ESP_GATT_DB_CHARACTERISTIC) {
+			// We now have a new characteristic ... let us add that to our set of known characteristics
+			pCharacteristic = new BLERemoteCharacteristic(
+				elem.attribute_handle,
+				BLEUUID(elem.uuid),
+				elem.properties,
+				this
+			);
+			std::string uuidStr = pCharacteristic->getUUID().toString();
+			ESP_LOGD(LOG_TAG, "Found a characteristic: Handle: %d, UUID: %s", elem.attribute_handle, uuidStr.c_str());
+			m_characteristicMap.insert(std::pair<std::string, BLERemoteCharacteristic*>(uuidStr, pCharacteristic));
+			m_characteristicMapByHandle.insert(std::pair<uint16_t, BLERemoteCharacteristic*>(elem.attribute_handle, pCharacteristic));
+			m_pClient->m_characteristicsByHandle[elem.attribute_handle] = pCharacteristic;
+		} else if (elem.type == ESP_GATT_DB_DESCRIPTOR && pCharacteristic != nullptr) {
+			BLERemoteDescriptor* pDescriptor = new BLERemoteDescriptor(
+				elem.attribute_handle,
+				BLEUUID(elem.uuid),
+				pCharacteristic
+			);
+			pCharacteristic->m_descriptorMap.insert(std::pair<std::string, BLERemoteDescriptor*>(pDescriptor->getUUID().toString(), pDescriptor));
 		}
-
-		ESP_LOGD(LOG_TAG, "Found a characteristic: Handle: %d, UUID: %s", result.char_handle, BLEUUID(result.uuid).toString().c_str());
-
-		// We now have a new characteristic ... let us add that to our set of known characteristics
-		BLERemoteCharacteristic *pNewRemoteCharacteristic = new BLERemoteCharacteristic(
-			result.char_handle,
-			BLEUUID(result.uuid),
-			result.properties,
-			this
-		);
-
-		m_characteristicMap.insert(std::pair<std::string, BLERemoteCharacteristic*>(pNewRemoteCharacteristic->getUUID().toString(), pNewRemoteCharacteristic));
-
-		offset++;   // Increment our count of number of descriptors found.
-	} // Loop forever (until we break inside the loop).
+	}
 
 	m_haveCharacteristics = true; // Remember that we have received the characteristics.
-	ESP_LOGD(LOG_TAG, "<< getCharacteristics()");
+	ESP_LOGD(LOG_TAG, "<< getCharacteristics(): %d characteristics", m_characteristicMap.size());
 } // getCharacteristics
 
 
@@ -232,6 +255,19 @@ std::map<std::string, BLERemoteCharacteristic *> * BLERemoteService::getCharacte
 } // getCharacteristics
 
 
+/**
+ * @brief Get the characteristics of this service keyed by handle.
+ * @param [out] pCharacteristicMap The map to which the characteristics are added.
+ * @return N/A.
+ */
+void BLERemoteService::getCharacteristics(std::map<uint16_t, BLERemoteCharacteristic*>* pCharacteristicMap) {
+	if (!m_haveCharacteristics) {
+		retrieveCharacteristics();
+	}
+	pCharacteristicMap->insert(m_characteristicMapByHandle.begin(), m_characteristicMapByHandle.end());
+} // getCharacteristics
+
+
 /**
  * @brief Get the client associated with this service.
  * @return A reference to the client associated with this service.
@@ -288,10 +324,12 @@ std::string BLERemoteService::getValue(BLEUUID characteristicUuid) {
  */
 void BLERemoteService::removeCharacteristics() {
 	for (auto &myPair : m_characteristicMap) {
+	   m_pClient->m_characteristicsByHandle.erase(myPair.second->getHandle());
 	   delete myPair.second;
 	   //m_characteristicMap.erase(myPair.first);  // Should be no need to delete as it will be deleted by the clear
 	}
 	m_characteristicMap.clear();   // Clear the map
+	m_characteristicMapByHandle.clear();
 } // removeCharacteristics
 
 
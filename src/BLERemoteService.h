@@ -50,6 +50,7 @@ private:
 	// Friends
 	friend class BLEClient;
 	friend class BLERemoteCharacteristic;
+	friend class BLEDiscoveryCache;
 
 	// Private methods
 	void                retrieveCharacteristics(void);   // Retrieve the characteristics from the BLE Server.
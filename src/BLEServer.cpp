@@ -11,11 +11,15 @@
 #include <esp_bt.h>
 #include <esp_bt_main.h>
 #include <esp_gap_ble_api.h>
+#if __has_include(<esp_idf_version.h>)
+#include <esp_idf_version.h>
+#endif
 //#include <esp_gatts_api.h>
 #include "BLEDevice.h"
 #include "BLEServer.h"
 #include "BLEService.h"
 #include "BLEUtils.h"
+#include "GeneralUtils.h"
 #include <string.h>
 #include <string>
 #include <unordered_set>
@@ -25,6 +29,17 @@
 
 static const char* LOG_TAG = "BLEServer";
 
+// esp_ble_gatts_send_service_change_indication() first appeared in ESP-IDF 4.1.
+#define SERVICE_CHANGE_INDICATION_SUPPORTED 0
+#if defined(ESP_IDF_VERSION_VAL)
+#if ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(4, 1, 0)
+#undef SERVICE_CHANGE_INDICATION_SUPPORTED
+#define SERVICE_CHANGE_INDICATION_SUPPORTED 1
+#endif
+#endif
+
+#define NULL_HANDLE (0xffff)
+
 
 /**
  * @brief Construct a %BLE Server
@@ -36,8 +51,14 @@ BLEServer::BLEServer() {
 	m_appId            = -1;
 	m_gatts_if         = -1;
 	m_connectedCount   = 0;
+	m_sharedEventWait  = false;
+	m_sharedEventExpected = -1;
+	m_updateDepth      = 0;
+	m_servicesChanged  = false;
 	m_connId           = -1;
 	m_pServerCallbacks = nullptr;
+	m_pExecutor        = nullptr;
+	m_pConnParamsPolicy = nullptr;
 
 	//createApp(0);
 } // BLEServer
@@ -114,6 +135,35 @@ BLEService* BLEServer::createService(BLEUUID uuid, uint32_t numHandles, uint8_t
 } // createService
 
 
+/**
+ * @brief Define a %BLE Service to be created from an attribute table.
+ *
+ * Unlike createService(), nothing is registered with the %BLE stack at this point.  The characteristics and
+ * descriptors are added to the returned service as usual and, when the service is started, the whole
+ * service is registered with a single esp_ble_gatts_create_attr_tab() request rather than one request per
+ * service, characteristic and descriptor.
+ * @param [in] uuid The UUID of the new service.
+ * @param [in] inst_id With multiple services with the same UUID we need to provide inst_id value different for each service.
+ * @return A reference to the new service object.
+ */
+BLEService* BLEServer::defineService(BLEUUID uuid, uint8_t inst_id) {
+	ESP_LOGD(LOG_TAG, ">> defineService - %s", uuid.toString().c_str());
+	if (m_serviceMap.getByUUID(uuid) != nullptr) {
+		ESP_LOGW(LOG_TAG, "<< Attempt to define a new service with uuid %s but a service with that UUID already exists.",
+			uuid.toString().c_str());
+	}
+
+	BLEService* pService = new BLEService(uuid, 0);   // The number of handles is computed when the table is built.
+	pService->m_id           = inst_id;
+	pService->m_pServer      = this;
+	pService->m_useAttrTable = true;
+	m_serviceMap.setByUUID(uuid, pService);
+
+	ESP_LOGD(LOG_TAG, "<< defineService");
+	return pService;
+} // defineService
+
+
 /**
  * @brief Retrieve the advertising object that can be used to advertise the existence of the server.
  *
@@ -152,6 +202,21 @@ void BLEServer::handleGAPEvent(
 		esp_ble_gap_cb_param_t* param) {
 	ESP_LOGD(LOG_TAG, "BLEServer ... handling GAP event!");
 	switch(event) {
+		// ESP_GAP_BLE_UPDATE_CONN_PARAMS_EVT
+		//
+		// update_conn_params:
+		// - esp_bt_status_t status
+		// - esp_bd_addr_t   bda
+		// - uint16_t        conn_int
+		//
+		case ESP_GAP_BLE_UPDATE_CONN_PARAMS_EVT: {
+			if (m_pConnParamsPolicy != nullptr) {
+				m_pConnParamsPolicy->onParamsUpdated(param->update_conn_params.bda,
+					param->update_conn_params.status, param->update_conn_params.conn_int);
+			}
+			break;
+		} // ESP_GAP_BLE_UPDATE_CONN_PARAMS_EVT
+
 		case ESP_GAP_BLE_ADV_DATA_SET_COMPLETE_EVT: {
 			/*
 			esp_ble_adv_params_t adv_params;
@@ -191,6 +256,19 @@ void BLEServer::handleGATTServerEvent(
 		esp_gatt_if_t             gatts_if,
 		esp_ble_gatts_cb_param_t* param) {
 
+	if (event == ESP_GATTS_WRITE_EVT) {
+		noteTraffic(param->write.conn_id, param->write.len);
+	}
+
+	// Writes to a characteristic with a raw write sink bypass the service and characteristic handlers.
+	if (event == ESP_GATTS_WRITE_EVT && !param->write.is_prep && !m_writeSinkMap.empty()) {
+		auto it = m_writeSinkMap.find(param->write.handle);
+		if (it != m_writeSinkMap.end()) {
+			it->second->handleRawWrite(gatts_if, param);
+			return;
+		}
+	}
+
 	ESP_LOGD(LOG_TAG, ">> handleGATTServerEvent: %s",
 		BLEUtils::gattServerEventTypeToString(event).c_str());
 
@@ -210,6 +288,19 @@ void BLEServer::handleGATTServerEvent(
 		} // ESP_GATTS_ADD_CHAR_EVT
 
 
+		// ESP_GATTS_CONF_EVT
+		//
+		// conf:
+		// - esp_gatt_status_t status
+		// - uint16_t          conn_id
+		// - uint16_t          handle
+		//
+		case ESP_GATTS_CONF_EVT: {
+			m_indicationQueue.confirm(param->conf.conn_id, param->conf.handle, param->conf.status);
+			break;
+		} // ESP_GATTS_CONF_EVT
+
+
 		// ESP_GATTS_CONNECT_EVT
 		// connect:
 		// - uint16_t      conn_id
@@ -218,8 +309,15 @@ void BLEServer::handleGATTServerEvent(
 		//
 		case ESP_GATTS_CONNECT_EVT: {
 			m_connId = param->connect.conn_id; // Save the connection id.
+			m_peerAddresses[param->connect.conn_id] = BLEAddress(param->connect.remote_bda).toString();
+			m_indicationQueue.open(param->connect.conn_id);
+			if (m_pConnParamsPolicy != nullptr) {
+				m_pConnParamsPolicy->onConnect(param->connect.conn_id, param->connect.remote_bda);
+			}
 			if (m_pServerCallbacks != nullptr) {
-				m_pServerCallbacks->onConnect(this, param);
+				if (m_pExecutor == nullptr || !m_pExecutor->post(runConnect, this, param)) {
+					runConnect(this, param);
+				}
 			}
 			m_connectedCount++;   // Increment the number of connected devices count.
 			break;
@@ -253,14 +351,57 @@ void BLEServer::handleGATTServerEvent(
 		// we also want to start advertising again.
 		case ESP_GATTS_DISCONNECT_EVT: {
 			m_connectedCount--;                          // Decrement the number of connected devices count.
+			m_prepareWritePool.release(param->disconnect.conn_id); // Discard any unexecuted prepared writes.
+			m_indicationQueue.release(param->disconnect.conn_id);  // Fail any unconfirmed indications.
+			m_peerAddresses.erase(param->disconnect.conn_id);
+			m_peerMTUs.erase(param->disconnect.conn_id);
+			if (m_pConnParamsPolicy != nullptr) {
+				m_pConnParamsPolicy->onDisconnect(param->disconnect.conn_id);
+			}
 			if (m_pServerCallbacks != nullptr) {         // If we have callbacks, call now.
-				m_pServerCallbacks->onDisconnect(this);
+				if (m_pExecutor == nullptr || !m_pExecutor->post(runDisconnect, this, param)) {
+					runDisconnect(this, param);
+				}
 			}
 			startAdvertising(); //- do this with some delay from the loop()
 			break;
 		} // ESP_GATTS_DISCONNECT_EVT
 
 
+		// ESP_GATTS_EXEC_WRITE_EVT
+		//
+		// exec_write:
+		// - uint16_t      conn_id
+		// - uint32_t      trans_id
+		// - esp_bd_addr_t bda
+		// - uint8_t       exec_write_flag
+		//
+		// Each characteristic with a prepared write from this connection has now committed or cancelled it.
+		// The client expects exactly one response to the execute write, so we send it here.
+		case ESP_GATTS_EXEC_WRITE_EVT: {
+			m_prepareWritePool.release(param->exec_write.conn_id);
+			esp_err_t errRc = ::esp_ble_gatts_send_response(
+					gatts_if,
+					param->exec_write.conn_id,
+					param->exec_write.trans_id, ESP_GATT_OK, nullptr);
+			if (errRc != ESP_OK) {
+				ESP_LOGE(LOG_TAG, "esp_ble_gatts_send_response: rc=%d %s", errRc, GeneralUtils::errorToString(errRc));
+			}
+			break;
+		} // ESP_GATTS_EXEC_WRITE_EVT
+
+
+		// ESP_GATTS_MTU_EVT
+		// mtu:
+		// - uint16_t conn_id
+		// - uint16_t mtu
+		//
+		case ESP_GATTS_MTU_EVT: {
+			m_peerMTUs[param->mtu.conn_id] = param->mtu.mtu;
+			break;
+		} // ESP_GATTS_MTU_EVT
+
+
 		// ESP_GATTS_READ_EVT - A request to read the value of a characteristic has arrived.
 		//
 		// read:
@@ -313,6 +454,20 @@ void BLEServer::handleGATTServerEvent(
 			break;
 		}
 
+
+		// ESP_GATTS_CONGEST_EVT
+		//
+		// congest:
+		// - uint16_t conn_id
+		// - bool     congested
+		//
+		case ESP_GATTS_CONGEST_EVT: {
+			if (m_pConnParamsPolicy != nullptr && param->congest.congested) {
+				m_pConnParamsPolicy->onBacklog(param->congest.conn_id);
+			}
+			break;
+		} // ESP_GATTS_CONGEST_EVT
+
 		default: {
 			break;
 		}
@@ -362,14 +517,353 @@ void BLEServer::setCallbacks(BLEServerCallbacks* pCallbacks) {
 	m_pServerCallbacks = pCallbacks;
 } // setCallbacks
 
-/*
- * Remove service
+/**
+ * @brief Remove a service from the server.
+ *
+ * The service is stopped and deleted from the %BLE stack.  Its handles are forgotten so that the stack may
+ * reuse the range for services added later, and connected clients are told with a Service Changed indication
+ * (or at endUpdate() when called within an update).  The service object is not deleted; it may be added back
+ * with addService().
+ * @param [in] service The service to remove.
  */
 void BLEServer::removeService(BLEService *service) {
+	bool wasCreated = service->getHandle() != NULL_HANDLE;
 	service->stop();
-	service->executeDelete();	
+	service->executeDelete();
 	m_serviceMap.removeService(service);
-}
+
+	BLECharacteristic* pCharacteristic = service->m_characteristicMap.getFirst();
+	while (pCharacteristic != nullptr) {
+		m_writeSinkMap.erase(pCharacteristic->getHandle());
+		pCharacteristic = service->m_characteristicMap.getNext();
+	}
+	service->resetHandles();
+
+	if (wasCreated) {
+		serviceChanged();
+	}
+} // removeService
+
+
+/**
+ * @brief Add a service, typically one previously removed with removeService(), to a running server.
+ *
+ * The service is created in the %BLE stack, which allocates its handles, possibly reusing a range freed by a
+ * removed service.  Call start() on the service to publish it; connected clients are then told with a Service
+ * Changed indication.
+ * @param [in] service The service to add.
+ */
+void BLEServer::addService(BLEService* service) {
+	ESP_LOGD(LOG_TAG, ">> addService - %s", service->getUUID().toString().c_str());
+	if (m_serviceMap.getByUUID(service->getUUID()) == service) {
+		ESP_LOGW(LOG_TAG, "<< addService: service already added");
+		return;
+	}
+	service->m_pServer = this;
+	m_serviceMap.setByUUID(service->getUUID(), service);
+	if (!service->m_useAttrTable) {   // Attribute table services are created when they are started.
+		service->executeCreate(this);
+	}
+	ESP_LOGD(LOG_TAG, "<< addService");
+} // addService
+
+
+/**
+ * @brief Start a batch of service additions and removals.
+ *
+ * Until the matching endUpdate(), the services added (started) or removed are not each indicated to the
+ * clients; one indication is sent at the end instead.  Updates may be nested.
+ */
+void BLEServer::beginUpdate() {
+	m_updateDepth++;
+} // beginUpdate
+
+
+/**
+ * @brief End a batch of service additions and removals.
+ * A single Service Changed indication is sent to the clients if any service was added or removed since
+ * beginUpdate().
+ */
+void BLEServer::endUpdate() {
+	if (m_updateDepth == 0) {
+		ESP_LOGE(LOG_TAG, "endUpdate without beginUpdate");
+		return;
+	}
+	if (--m_updateDepth == 0 && m_servicesChanged) {
+		m_servicesChanged = false;
+		serviceChanged();
+	}
+} // endUpdate
+
+
+/**
+ * @brief Tell the connected clients that the services have changed.
+ *
+ * The Service Changed characteristic (0x2A05) belongs to the Generic Attribute service of the %BLE stack, so the
+ * indication is sent through the stack, to every connected client.  The stack chooses the handle range the
+ * indication carries; it has no way to be given the range of the services actually changed, so clients
+ * rediscover all of the services.  Within an update the change is only recorded.
+ *
+ * The stack has provided this from ESP-IDF 4.1; with an older stack nothing is sent and clients only see the
+ * change once they reconnect and discover the services again.
+ */
+void BLEServer::serviceChanged() {
+	if (m_updateDepth > 0) {
+		m_servicesChanged = true;
+		return;
+	}
+	if (m_connectedCount == 0) {
+		return;
+	}
+#if SERVICE_CHANGE_INDICATION_SUPPORTED
+	ESP_LOGD(LOG_TAG, ">> serviceChanged");
+	esp_err_t errRc = ::esp_ble_gatts_send_service_change_indication(m_gatts_if, nullptr);   // nullptr for all clients.
+	if (errRc != ESP_OK) {
+		ESP_LOGE(LOG_TAG, "esp_ble_gatts_send_service_change_indication: rc=%d %s", errRc, GeneralUtils::errorToString(errRc));
+	}
+#else
+	ESP_LOGW(LOG_TAG, "serviceChanged: this ESP-IDF cannot send a Service Changed indication");
+#endif
+} // serviceChanged
+
+/**
+ * @brief Set the limits for prepared (long) writes.
+ *
+ * A client writing a value longer than fits in a single request sends it in pieces which are assembled in
+ * a pool of buffers owned by the server.  This should be called before any client connects.
+ *
+ * @param [in] maxWrites The number of prepared writes (one per connection and characteristic) that may be in progress at once.
+ * @param [in] maxLength The maximum length of a value assembled from a prepared write.
+ */
+void BLEServer::setPrepareWriteLimits(uint8_t maxWrites, uint16_t maxLength) {
+	m_prepareWritePool.setLimits(maxWrites, maxLength);
+} // setPrepareWriteLimits
+
+
+/**
+ * @brief Share one event semaphore between all the services, characteristics and descriptors of the server.
+ *
+ * Each of those objects otherwise waits for the completion of its %BLE requests on semaphores of its own.
+ * The stack completes requests one at a time, so a server whose GATT operations are issued from a single task
+ * can use one semaphore for all of them, and the per object semaphores are then never allocated.  The event
+ * each request waits for is recorded, so that only that event ends the wait.  Notifications and indications
+ * keep the semaphore of their characteristic, since they complete on events of their own.  Call this before
+ * creating services.
+ * @param [in] shared True to share one event semaphore.
+ */
+void BLEServer::setSharedEventWait(bool shared) {
+	m_sharedEventWait = shared;
+} // setSharedEventWait
+
+
+/**
+ * @brief Return the semaphore on which to wait for a %BLE event of a server object.
+ * When the server shares one event semaphore between all its objects, that one is used instead of the object's own.
+ * @param [in] pServer The server owning the object, or nullptr if it has none yet.
+ * @param [in] semaphore The object's own semaphore for the event.
+ * @return The semaphore to use.
+ */
+FreeRTOS::Semaphore& BLEServer::eventSemaphore(BLEServer* pServer, FreeRTOS::Semaphore& semaphore) {
+	if (pServer != nullptr && pServer->m_sharedEventWait) {
+		return pServer->m_semaphoreSharedEvt;
+	}
+	return semaphore;
+} // eventSemaphore
+
+
+/**
+ * @brief Take the semaphore on which to wait for a %BLE event of a server object.
+ * With a shared event semaphore the event is recorded, so that only that event releases the wait.
+ * @param [in] pServer The server owning the object, or nullptr if it has none yet.
+ * @param [in] semaphore The object's own semaphore for the event.
+ * @param [in] event The event that completes the request.
+ * @param [in] owner The owner to record for the semaphore.
+ */
+void BLEServer::takeEventSemaphore(BLEServer* pServer, FreeRTOS::Semaphore& semaphore, esp_gatts_cb_event_t event, std::string owner) {
+	FreeRTOS::Semaphore& eventSem = eventSemaphore(pServer, semaphore);
+	eventSem.take(owner);
+	if (&eventSem != &semaphore) {
+		pServer->m_sharedEventExpected = event;
+	}
+} // takeEventSemaphore
+
+
+/**
+ * @brief Give the semaphore on which a %BLE event of a server object is waited for.
+ * Every object sees every event, so a shared event semaphore is only given if the request waiting on it
+ * completes with this event; otherwise an event completing some other request (or no request at all)
+ * would wake the waiter before its own event had arrived.
+ * @param [in] pServer The server owning the object, or nullptr if it has none yet.
+ * @param [in] semaphore The object's own semaphore for the event.
+ * @param [in] event The event received.
+ */
+void BLEServer::giveEventSemaphore(BLEServer* pServer, FreeRTOS::Semaphore& semaphore, esp_gatts_cb_event_t event) {
+	if (&eventSemaphore(pServer, semaphore) == &semaphore) {
+		semaphore.give();
+		return;
+	}
+	if (pServer->m_sharedEventExpected != event) {
+		return;
+	}
+	pServer->m_sharedEventExpected = -1;
+	pServer->m_semaphoreSharedEvt.give();
+} // giveEventSemaphore
+
+
+/**
+ * @brief Get the RAM used by the GATT database of the server.
+ * The services, characteristics and descriptors, including the heap they own, are counted.
+ * @return The number of bytes used.
+ */
+size_t BLEServer::getMemoryUsage() {
+	size_t size = sizeof(BLEServer) + m_serviceMap.getMemoryUsage() + m_semaphoreSharedEvt.getHeapSize();
+	size += m_semaphoreReadState.getHeapSize() + m_semaphoreOnRead.getHeapSize();
+	BLEService* pService = m_serviceMap.getFirst();
+	while (pService != nullptr) {
+		size += pService->getMemoryUsage();
+		BLECharacteristic* pCharacteristic = pService->m_characteristicMap.getFirst();
+		while (pCharacteristic != nullptr) {
+			size += pCharacteristic->getMemoryUsage();
+			BLEDescriptor* pDescriptor = pCharacteristic->m_descriptorMap.getFirst();
+			while (pDescriptor != nullptr) {
+				size += pDescriptor->getMemoryUsage();
+				pDescriptor = pCharacteristic->m_descriptorMap.getNext();
+			}
+			pCharacteristic = pService->m_characteristicMap.getNext();
+		}
+		pService = m_serviceMap.getNext();
+	}
+	return size;
+} // getMemoryUsage
+
+
+/**
+ * @brief Log the RAM used by each service, characteristic and descriptor of the server.
+ */
+void BLEServer::dumpMemoryUsage() {
+	ESP_LOGI(LOG_TAG, "Object sizes: server=%d, service=%d, characteristic=%d, descriptor=%d",
+		sizeof(BLEServer), sizeof(BLEService), sizeof(BLECharacteristic), sizeof(BLEDescriptor));
+	BLEService* pService = m_serviceMap.getFirst();
+	while (pService != nullptr) {
+		ESP_LOGI(LOG_TAG, "Service %s: %d", pService->getUUID().toString().c_str(), pService->getMemoryUsage());
+		BLECharacteristic* pCharacteristic = pService->m_characteristicMap.getFirst();
+		while (pCharacteristic != nullptr) {
+			ESP_LOGI(LOG_TAG, "  Characteristic %s: %d", pCharacteristic->getUUID().toString().c_str(), pCharacteristic->getMemoryUsage());
+			BLEDescriptor* pDescriptor = pCharacteristic->m_descriptorMap.getFirst();
+			while (pDescriptor != nullptr) {
+				ESP_LOGI(LOG_TAG, "    Descriptor %s: %d", pDescriptor->getUUID().toString().c_str(), pDescriptor->getMemoryUsage());
+				pDescriptor = pCharacteristic->m_descriptorMap.getNext();
+			}
+			pCharacteristic = pService->m_characteristicMap.getNext();
+		}
+		pService = m_serviceMap.getNext();
+	}
+	ESP_LOGI(LOG_TAG, "Total: %d", getMemoryUsage());
+} // dumpMemoryUsage
+
+
+/**
+ * @brief Run onConnect() and onDisconnect() on the worker task of an executor.
+ *
+ * The callbacks keep their order, with each other and with any characteristic callbacks posted to the same
+ * executor.  By the time onConnect() runs the client may already have gone.
+ * @param [in] pExecutor The executor, or nullptr to invoke the callbacks on the %BLE task (the default).
+ */
+void BLEServer::setCallbackExecutor(BLECallbackExecutor* pExecutor) {
+	m_pExecutor = pExecutor;
+} // setCallbackExecutor
+
+
+/**
+ * @brief Get the link layer data length negotiated on a connection.
+ * See BLEDevice::setDataLength().
+ * @param [in] connId The connection.
+ * @return The payload of a link layer packet sent on the connection, 27 until Data Length Extension has been negotiated.
+ */
+uint16_t BLEServer::getDataLength(uint16_t connId) {
+	auto it = m_peerAddresses.find(connId);
+	if (it == m_peerAddresses.end()) {
+		return 27;
+	}
+	return BLEDevice::getDataLength(BLEAddress(it->second));
+} // getDataLength
+
+
+/**
+ * @brief Get the ATT MTU negotiated on a connection.
+ * @param [in] connId The connection.
+ * @return The MTU of the connection, 23 until the client has exchanged MTUs.
+ */
+uint16_t BLEServer::getPeerMTU(uint16_t connId) {
+	auto it = m_peerMTUs.find(connId);
+	if (it == m_peerMTUs.end()) {
+		return 23;
+	}
+	return it->second;
+} // getPeerMTU
+
+
+/**
+ * @brief Tune the connection parameters to the traffic on each connection.
+ *
+ * The policy is told of connections, of notifications, indications and writes, and of congestion, and is
+ * started.  It remains owned by the caller.
+ * @param [in] pPolicy The policy, or nullptr to leave the connection parameters alone (the default).
+ */
+void BLEServer::setConnParamsPolicy(BLEConnParamsPolicy* pPolicy) {
+	if (m_pConnParamsPolicy != nullptr) {
+		m_pConnParamsPolicy->stop();
+	}
+	m_pConnParamsPolicy = pPolicy;
+	if (pPolicy != nullptr) {
+		pPolicy->start();
+	}
+} // setConnParamsPolicy
+
+
+/**
+ * @brief Count traffic on a connection for the connection parameter policy.
+ * @param [in] connId The connection.
+ * @param [in] length The number of bytes sent or received.
+ */
+void BLEServer::noteTraffic(uint16_t connId, size_t length) {
+	if (m_pConnParamsPolicy != nullptr) {
+		m_pConnParamsPolicy->onTraffic(connId, length);
+	}
+} // noteTraffic
+
+
+/**
+ * @brief Invoke the onConnect() callbacks.
+ * @param [in] pObject The server.
+ * @param [in] param The connect event.
+ */
+void BLEServer::runConnect(void* pObject, esp_ble_gatts_cb_param_t* param) {
+	BLEServer* pServer = (BLEServer*)pObject;
+	pServer->m_pServerCallbacks->onConnect(pServer, param);
+} // runConnect
+
+
+/**
+ * @brief Invoke the onDisconnect() callback.
+ * @param [in] pObject The server.
+ * @param [in] param The disconnect event.
+ */
+void BLEServer::runDisconnect(void* pObject, esp_ble_gatts_cb_param_t* param) {
+	BLEServer* pServer = (BLEServer*)pObject;
+	pServer->m_pServerCallbacks->onDisconnect(pServer);
+} // runDisconnect
+
+
+/**
+ * @brief Set the limits for indications queued with BLECharacteristic::indicateAsync().
+ *
+ * @param [in] maxQueued The number of indications that may be queued on each connection, including the one awaiting confirmation.
+ * @param [in] timeoutMs How long to wait for the client to confirm an indication.
+ */
+void BLEServer::setIndicationLimits(uint8_t maxQueued, uint32_t timeoutMs) {
+	m_indicationQueue.setLimits(maxQueued, timeoutMs);
+} // setIndicationLimits
 
 /**
  * @brief Update the connection parameters
@@ -11,12 +11,18 @@
 #if defined(CONFIG_BT_ENABLED)
 #include <esp_gatts_api.h>
 
+#include <map>
 #include <string>
 #include <string.h>
+#include <vector>
 
 #include "BLEUUID.h"
 #include "BLEAdvertising.h"
+#include "BLECallbackExecutor.h"
 #include "BLECharacteristic.h"
+#include "BLEConnParamsPolicy.h"
+#include "BLEIndicationQueue.h"
+#include "BLEPrepareWritePool.h"
 #include "BLEService.h"
 #include "BLESecurity.h"
 #include "FreeRTOS.h"
@@ -44,10 +50,12 @@ public:
 	BLEService* getNext();
 	void 		removeService(BLEService *service);
 
+	size_t      getMemoryUsage();
 private:
 	std::map<uint16_t, BLEService*>    m_handleMap;
-	std::map<BLEService*, std::string> m_uuidMap;
-	std::map<BLEService*, std::string>::iterator m_iterator;
+	std::vector<BLEService*>           m_services;                       // In the order they were added.
+	std::vector<std::pair<BLEUUIDKey, BLEService*>> m_uuidIndex;         // Sorted by UUID key.
+	size_t                             m_iterator = 0;
 };
 
 
@@ -57,13 +65,26 @@ private:
 class BLEServer {
 public:
 	~BLEServer() ;
+	void            addService(BLEService* service);
+	void            beginUpdate();
+	void            endUpdate();
+	void            dumpMemoryUsage();
 	uint32_t        getConnectedCount();
+	uint16_t        getDataLength(uint16_t connId);
+	uint16_t        getPeerMTU(uint16_t connId);
+	size_t          getMemoryUsage();
 	BLEService*     createService(const char* uuid);	
 	BLEService*     createService(BLEUUID uuid, uint32_t numHandles=15, uint8_t inst_id=0);
+	BLEService*     defineService(BLEUUID uuid, uint8_t inst_id=0);
 	BLEAdvertising* getAdvertising();
+	void            setCallbackExecutor(BLECallbackExecutor* pExecutor);
 	void            setCallbacks(BLEServerCallbacks* pCallbacks);
+	void            setConnParamsPolicy(BLEConnParamsPolicy* pPolicy);
 	void            startAdvertising();
 	void 			removeService(BLEService *service);
+	void            setIndicationLimits(uint8_t maxQueued, uint32_t timeoutMs);
+	void            setSharedEventWait(bool shared);
+	void            setPrepareWriteLimits(uint8_t maxWrites, uint16_t maxLength);
     void            updateConnParams(esp_bd_addr_t remote_bda, uint16_t minInterval, uint16_t maxInterval, uint16_t latency, uint16_t timeout);
 
 private:
@@ -71,6 +92,8 @@ private:
 	friend class BLEService;
 	friend class BLECharacteristic;
 	friend class BLEDevice;
+	friend class BLEIndicationQueue;
+	friend class BLEDescriptor;
 	esp_ble_adv_data_t  m_adv_data;
 	uint16_t            m_appId;
 	BLEAdvertising      m_bleAdvertising;
@@ -85,14 +108,35 @@ private:
 
 	BLEServiceMap       m_serviceMap;
 	BLEServerCallbacks* m_pServerCallbacks;
+	BLECallbackExecutor* m_pExecutor;
+	BLEConnParamsPolicy* m_pConnParamsPolicy;
+	BLEPrepareWritePool m_prepareWritePool;
+	BLEIndicationQueue  m_indicationQueue;
+	bool                m_sharedEventWait;   // Services, characteristics and descriptors wait on m_semaphoreSharedEvt.
+	FreeRTOS::Semaphore m_semaphoreSharedEvt = FreeRTOS::Semaphore("SharedEvt");
+	int                 m_sharedEventExpected;   // The event m_semaphoreSharedEvt waits for, -1 for none.
+	FreeRTOS::Semaphore m_semaphoreReadState = FreeRTOS::Semaphore("ReadState");   // Guards the read snapshots and deferred reads of the characteristics.
+	FreeRTOS::Semaphore m_semaphoreOnRead    = FreeRTOS::Semaphore("OnRead");      // Held while a characteristic's onRead() runs.
+	uint8_t             m_updateDepth;       // Nesting of beginUpdate() / endUpdate().
+	bool                m_servicesChanged;   // A service was added or removed since beginUpdate().
+	std::map<uint16_t, std::string>        m_peerAddresses;  // The address of each connected client, by conn_id.
+	std::map<uint16_t, uint16_t>           m_peerMTUs;       // The MTU negotiated with each connected client, by conn_id.
+	std::map<uint16_t, BLECharacteristic*> m_writeSinkMap;   // Characteristics with a raw write sink, by handle.
 
 	void            createApp(uint16_t appId);
 	void            deleteApp(void);
+	static FreeRTOS::Semaphore& eventSemaphore(BLEServer* pServer, FreeRTOS::Semaphore& semaphore);
 	uint16_t        getConnId();
 	uint16_t        getGattsIf();
+	static void     giveEventSemaphore(BLEServer* pServer, FreeRTOS::Semaphore& semaphore, esp_gatts_cb_event_t event);
 	void            handleGAPEvent(esp_gap_ble_cb_event_t event,	esp_ble_gap_cb_param_t *param);
 	void            handleGATTServerEvent(esp_gatts_cb_event_t event, esp_gatt_if_t gatts_if, esp_ble_gatts_cb_param_t *param);
+	void            noteTraffic(uint16_t connId, size_t length);
 	void            registerApp();
+	static void     runConnect(void* pObject, esp_ble_gatts_cb_param_t* param);
+	static void     runDisconnect(void* pObject, esp_ble_gatts_cb_param_t* param);
+	void            serviceChanged();
+	static void     takeEventSemaphore(BLEServer* pServer, FreeRTOS::Semaphore& semaphore, esp_gatts_cb_event_t event, std::string owner);
 	void            unregisterApp(uint16_t);
 }; // BLEServer
 
@@ -51,6 +51,7 @@ BLEService::BLEService(BLEUUID uuid, uint32_t numHandles) {
 	//m_serializeMutex.setName("BLEService");
 	m_lastCreatedCharacteristic = nullptr;
 	m_numHandles = numHandles;
+	m_useAttrTable = false;
 } // BLEService
 
 
@@ -69,7 +70,7 @@ void BLEService::executeCreate(BLEServer *pServer) {
 	//char x[10];
 	//memcpy(x, &deleteMe, 10);
 	m_pServer          = pServer;
-	m_semaphoreCreateEvt.take("executeCreate"); // Take the mutex and release at event ESP_GATTS_CREATE_EVT
+	BLEServer::takeEventSemaphore(m_pServer, m_semaphoreCreateEvt, ESP_GATTS_CREATE_EVT, "executeCreate"); // Take the mutex and release at event ESP_GATTS_CREATE_EVT
 
 	esp_gatt_srvc_id_t srvc_id;
 	srvc_id.is_primary = true;
@@ -86,11 +87,102 @@ void BLEService::executeCreate(BLEServer *pServer) {
 		return;
 	}
 
-	m_semaphoreCreateEvt.wait("executeCreate");
+	BLEServer::eventSemaphore(m_pServer, m_semaphoreCreateEvt).wait("executeCreate");
 	ESP_LOGD(LOG_TAG, "<< executeCreate");
 } // executeCreate
 
 
+/**
+ * @brief Build an attribute table entry.
+ * @param [in] pUUID The UUID of the attribute.
+ * @param [in] perm The access permissions of the attribute.
+ * @param [in] maxLength The maximum length of the attribute value.
+ * @param [in] length The initial length of the attribute value.
+ * @param [in] pValue The initial attribute value.
+ * @return The attribute table entry.
+ */
+static esp_gatts_attr_db_t buildAttr(esp_bt_uuid_t* pUUID, esp_gatt_perm_t perm, uint16_t maxLength, uint16_t length, uint8_t* pValue) {
+	esp_gatts_attr_db_t attr;
+	attr.attr_control.auto_rsp = ESP_GATT_RSP_BY_APP;
+	attr.att_desc.uuid_length  = pUUID->len;
+	attr.att_desc.uuid_p       = (uint8_t*)&pUUID->uuid;
+	attr.att_desc.perm         = perm;
+	attr.att_desc.max_length   = maxLength;
+	attr.att_desc.length       = length;
+	attr.att_desc.value        = pValue;
+	return attr;
+} // buildAttr
+
+
+/**
+ * @brief Build the attribute table describing this service.
+ * The table holds the service declaration followed, for each characteristic, by the characteristic
+ * declaration, the characteristic value and its descriptors.  The handles returned by the %BLE stack
+ * follow the same order.
+ */
+void BLEService::buildAttrTable() {
+	static esp_bt_uuid_t primaryServiceUUID   = { ESP_UUID_LEN_16, { ESP_GATT_UUID_PRI_SERVICE } };
+	static esp_bt_uuid_t characteristicUUID   = { ESP_UUID_LEN_16, { ESP_GATT_UUID_CHAR_DECLARE } };
+
+	m_attrTable.clear();
+	esp_bt_uuid_t* pServiceUUID = m_uuid.getNative();
+	m_attrTable.push_back(buildAttr(&primaryServiceUUID, ESP_GATT_PERM_READ, pServiceUUID->len, pServiceUUID->len, (uint8_t*)&pServiceUUID->uuid));
+
+	BLECharacteristic* pCharacteristic = m_characteristicMap.getFirst();
+	while (pCharacteristic != nullptr) {
+		pCharacteristic->m_pService = this;
+		m_attrTable.push_back(buildAttr(&characteristicUUID, ESP_GATT_PERM_READ,
+			sizeof(esp_gatt_char_prop_t), sizeof(esp_gatt_char_prop_t), (uint8_t*)&pCharacteristic->m_properties));
+		// The value is answered by us (ESP_GATT_RSP_BY_APP), never by the stack, so as in BLECharacteristic::executeCreate()
+		// no value is given; the stack would otherwise allocate max_length bytes for each characteristic.
+		m_attrTable.push_back(buildAttr(pCharacteristic->m_bleUUID.getNative(), pCharacteristic->m_permissions,
+			0, 0, nullptr));
+
+		BLEDescriptor* pDescriptor = pCharacteristic->m_descriptorMap.getFirst();
+		while (pDescriptor != nullptr) {
+			pDescriptor->m_pCharacteristic = pCharacteristic;
+			m_attrTable.push_back(buildAttr(pDescriptor->m_bleUUID.getNative(), pDescriptor->m_permissions,
+				pDescriptor->m_value.attr_max_len, pDescriptor->m_value.attr_len, pDescriptor->m_value.attr_value));
+			pDescriptor = pCharacteristic->m_descriptorMap.getNext();
+		}
+		pCharacteristic = m_characteristicMap.getNext();
+	}
+	m_numHandles = m_attrTable.size();
+} // buildAttrTable
+
+
+/**
+ * @brief Create the service, its characteristics and their descriptors with a single request.
+ * The handles of all the attributes are delivered by the ESP_GATTS_CREAT_ATTR_TAB_EVT event.
+ */
+void BLEService::executeCreateTable() {
+	ESP_LOGD(LOG_TAG, ">> executeCreateTable() - %s", getUUID().toString().c_str());
+	buildAttrTable();
+	if (m_attrTable.size() > UINT8_MAX) {
+		ESP_LOGE(LOG_TAG, "<< Too many attributes (%d) for one attribute table", m_attrTable.size());
+		return;
+	}
+
+	BLEServer::takeEventSemaphore(m_pServer, m_semaphoreCreateEvt, ESP_GATTS_CREAT_ATTR_TAB_EVT, "executeCreateTable"); // Released at event ESP_GATTS_CREAT_ATTR_TAB_EVT
+	esp_err_t errRc = ::esp_ble_gatts_create_attr_tab(
+		&m_attrTable[0],
+		getServer()->getGattsIf(),
+		m_attrTable.size(),
+		m_id);
+
+	if (errRc != ESP_OK) {
+		ESP_LOGE(LOG_TAG, "esp_ble_gatts_create_attr_tab: rc=%d %s", errRc, GeneralUtils::errorToString(errRc));
+		BLEServer::giveEventSemaphore(m_pServer, m_semaphoreCreateEvt, ESP_GATTS_CREAT_ATTR_TAB_EVT);
+		return;
+	}
+
+	BLEServer::eventSemaphore(m_pServer, m_semaphoreCreateEvt).wait("executeCreateTable");
+	m_attrTable.clear();
+	m_attrTable.shrink_to_fit();
+	ESP_LOGD(LOG_TAG, "<< executeCreateTable");
+} // executeCreateTable
+
+
 /**
  * @brief Delete the service.
  * Delete the service.
@@ -99,7 +191,7 @@ void BLEService::executeCreate(BLEServer *pServer) {
 
 void BLEService::executeDelete() {
 	ESP_LOGD(LOG_TAG, ">> executeDelete()");
-	m_semaphoreDeleteEvt.take("executeDelete"); // Take the mutex and release at event ESP_GATTS_DELETE_EVT
+	BLEServer::takeEventSemaphore(m_pServer, m_semaphoreDeleteEvt, ESP_GATTS_DELETE_EVT, "executeDelete"); // Take the mutex and release at event ESP_GATTS_DELETE_EVT
 
 	esp_err_t errRc = ::esp_ble_gatts_delete_service( getHandle() );
 
@@ -108,7 +200,7 @@ void BLEService::executeDelete() {
 		return;
 	}
 
-	m_semaphoreDeleteEvt.wait("executeDelete");
+	BLEServer::eventSemaphore(m_pServer, m_semaphoreDeleteEvt).wait("executeDelete");
 	ESP_LOGD(LOG_TAG, "<< executeDelete");
 } // executeDelete
 
@@ -125,6 +217,20 @@ void BLEService::dump() {
 } // dump
 
 
+/**
+ * @brief Get the RAM used by the service.
+ * The characteristics of the service are not included, see BLECharacteristic::getMemoryUsage().
+ * @return The size of the service object plus the heap it owns.
+ */
+size_t BLEService::getMemoryUsage() {
+	size_t size = sizeof(BLEService) + m_characteristicMap.getMemoryUsage();
+	size += m_semaphoreCreateEvt.getHeapSize() + m_semaphoreDeleteEvt.getHeapSize();
+	size += m_semaphoreStartEvt.getHeapSize() + m_semaphoreStopEvt.getHeapSize();
+	size += m_attrTable.capacity() * sizeof(esp_gatts_attr_db_t);
+	return size;
+} // getMemoryUsage
+
+
 /**
  * @brief Get the UUID of the service.
  * @return the UUID of the service.
@@ -146,30 +252,36 @@ void BLEService::start() {
 // obtained as a result of calling esp_ble_gatts_create_service().
 //
 	ESP_LOGD(LOG_TAG, ">> start(): Starting service (esp_ble_gatts_start_service): %s", toString().c_str());
+	if (m_useAttrTable && m_handle == NULL_HANDLE) {
+		executeCreateTable();   // Creates the service, characteristics and descriptors in one go.
+	}
 	if (m_handle == NULL_HANDLE) {
 		ESP_LOGE(LOG_TAG, "<< !!! We attempted to start a service but don't know its handle!");
 		return;
 	}
 
 
-	BLECharacteristic *pCharacteristic = m_characteristicMap.getFirst();
+	if (!m_useAttrTable) {
+		BLECharacteristic *pCharacteristic = m_characteristicMap.getFirst();
 
-	while(pCharacteristic != nullptr) {
-		m_lastCreatedCharacteristic = pCharacteristic;
-		pCharacteristic->executeCreate(this);
+		while(pCharacteristic != nullptr) {
+			m_lastCreatedCharacteristic = pCharacteristic;
+			pCharacteristic->executeCreate(this);
 
-		pCharacteristic = m_characteristicMap.getNext();
+			pCharacteristic = m_characteristicMap.getNext();
+		}
+		// Start each of the characteristics ... these are found in the m_characteristicMap.
 	}
-	// Start each of the characteristics ... these are found in the m_characteristicMap.
 
-	m_semaphoreStartEvt.take("start");
+	BLEServer::takeEventSemaphore(m_pServer, m_semaphoreStartEvt, ESP_GATTS_START_EVT, "start");
 	esp_err_t errRc = ::esp_ble_gatts_start_service(m_handle);
 
 	if (errRc != ESP_OK) {
 		ESP_LOGE(LOG_TAG, "<< esp_ble_gatts_start_service: rc=%d %s", errRc, GeneralUtils::errorToString(errRc));
 		return;
 	}
-	m_semaphoreStartEvt.wait("start");
+	BLEServer::eventSemaphore(m_pServer, m_semaphoreStartEvt).wait("start");
+	m_pServer->serviceChanged();   // Tell any connected clients about the new service.
 
 	ESP_LOGD(LOG_TAG, "<< start()");
 } // start
@@ -190,14 +302,14 @@ void BLEService::stop() {
 		return;
 	}
 
-	m_semaphoreStopEvt.take("stop");
+	BLEServer::takeEventSemaphore(m_pServer, m_semaphoreStopEvt, ESP_GATTS_STOP_EVT, "stop");
 	esp_err_t errRc = ::esp_ble_gatts_stop_service(m_handle);
 
 	if (errRc != ESP_OK) {
 		ESP_LOGE(LOG_TAG, "<< esp_ble_gatts_stop_service: rc=%d %s", errRc, GeneralUtils::errorToString(errRc));
 		return;
 	}
-	m_semaphoreStopEvt.wait("stop");
+	BLEServer::eventSemaphore(m_pServer, m_semaphoreStopEvt).wait("stop");
 
 	ESP_LOGD(LOG_TAG, "<< stop()");
 } // start
@@ -218,6 +330,57 @@ void BLEService::setHandle(uint16_t handle) {
 } // setHandle
 
 
+/**
+ * @brief Forget the handles of the service, its characteristics and descriptors.
+ * Used once the service has been deleted from the %BLE stack so that it can be created again.
+ */
+void BLEService::resetHandles() {
+	m_handle = NULL_HANDLE;
+	BLECharacteristic* pCharacteristic = m_characteristicMap.getFirst();
+	while (pCharacteristic != nullptr) {
+		pCharacteristic->setHandle(NULL_HANDLE);
+		BLEDescriptor* pDescriptor = pCharacteristic->m_descriptorMap.getFirst();
+		while (pDescriptor != nullptr) {
+			pDescriptor->m_handle = NULL_HANDLE;
+			pDescriptor = pCharacteristic->m_descriptorMap.getNext();
+		}
+		pCharacteristic = m_characteristicMap.getNext();
+	}
+	m_characteristicMap.removeHandles();
+} // resetHandles
+
+
+/**
+ * @brief Set the handles of the service, its characteristics and descriptors from an attribute table.
+ * The handles are in the same order as the entries of the table built by buildAttrTable().
+ * @param [in] pHandles The handles returned by the %BLE stack.
+ * @param [in] numHandles The number of handles.
+ */
+void BLEService::setHandlesFromTable(uint16_t* pHandles, uint16_t numHandles) {
+	if (numHandles != m_numHandles) {
+		ESP_LOGE(LOG_TAG, "Attribute table created with %d handles, expected %d", numHandles, m_numHandles);
+		return;
+	}
+	uint16_t* pHandle = pHandles;
+	setHandle(*pHandle++);
+	m_pServer->m_serviceMap.setByHandle(m_handle, this);
+
+	BLECharacteristic* pCharacteristic = m_characteristicMap.getFirst();
+	while (pCharacteristic != nullptr) {
+		pHandle++;                                  // Skip the characteristic declaration.
+		pCharacteristic->setHandle(*pHandle);
+		m_characteristicMap.setByHandle(*pHandle++, pCharacteristic);
+
+		BLEDescriptor* pDescriptor = pCharacteristic->m_descriptorMap.getFirst();
+		while (pDescriptor != nullptr) {
+			pDescriptor->setHandle(*pHandle++);
+			pDescriptor = pCharacteristic->m_descriptorMap.getNext();
+		}
+		pCharacteristic = m_characteristicMap.getNext();
+	}
+} // setHandlesFromTable
+
+
 /**
  * @brief Get the handle associated with this service.
  * @return The handle associated with this service.
@@ -323,7 +486,7 @@ void BLEService::handleGATTServerEvent(
 		// uint16_t service_handle
 		case ESP_GATTS_START_EVT: {
 			if (param->start.service_handle == getHandle()) {
-				m_semaphoreStartEvt.give();
+				BLEServer::giveEventSemaphore(m_pServer, m_semaphoreStartEvt, ESP_GATTS_START_EVT);
 			}
 			break;
 		} // ESP_GATTS_START_EVT
@@ -336,7 +499,7 @@ void BLEService::handleGATTServerEvent(
 		//
 		case ESP_GATTS_STOP_EVT: {
 			if (param->stop.service_handle == getHandle()) {
-				m_semaphoreStopEvt.give();
+				BLEServer::giveEventSemaphore(m_pServer, m_semaphoreStopEvt, ESP_GATTS_STOP_EVT);
 			}
 			break;
 		} // ESP_GATTS_STOP_EVT
@@ -357,12 +520,36 @@ void BLEService::handleGATTServerEvent(
 		case ESP_GATTS_CREATE_EVT: {
 			if (getUUID().equals(BLEUUID(param->create.service_id.id.uuid)) && m_id == param->create.service_id.id.inst_id) {
 				setHandle(param->create.service_handle);
-				m_semaphoreCreateEvt.give();
+				BLEServer::giveEventSemaphore(m_pServer, m_semaphoreCreateEvt, ESP_GATTS_CREATE_EVT);
 			}
 			break;
 		} // ESP_GATTS_CREATE_EVT
 
 
+		// ESP_GATTS_CREAT_ATTR_TAB_EVT
+		// Called when a service has been created from an attribute table.
+		//
+		// add_attr_tab:
+		// * esp_gatt_status_t status
+		// * esp_bt_uuid_t     svc_uuid
+		// * uint8_t           svc_inst_id
+		// * uint16_t          num_handle
+		// * uint16_t*         handles
+		//
+		case ESP_GATTS_CREAT_ATTR_TAB_EVT: {
+			if (m_useAttrTable && m_handle == NULL_HANDLE &&
+					getUUID().equals(BLEUUID(param->add_attr_tab.svc_uuid)) && m_id == param->add_attr_tab.svc_inst_id) {
+				if (param->add_attr_tab.status == ESP_GATT_OK) {
+					setHandlesFromTable(param->add_attr_tab.handles, param->add_attr_tab.num_handle);
+				} else {
+					ESP_LOGE(LOG_TAG, "Attribute table creation failed: status=%d", param->add_attr_tab.status);
+				}
+				BLEServer::giveEventSemaphore(m_pServer, m_semaphoreCreateEvt, ESP_GATTS_CREAT_ATTR_TAB_EVT);
+			}
+			break;
+		} // ESP_GATTS_CREAT_ATTR_TAB_EVT
+
+
 		// ESP_GATTS_DELETE_EVT
 		// Called when a service is deleted.
 		//
@@ -372,7 +559,7 @@ void BLEService::handleGATTServerEvent(
 		//
 		case ESP_GATTS_DELETE_EVT: {
 			if (param->del.service_handle == getHandle()) {
-				m_semaphoreDeleteEvt.give();
+				BLEServer::giveEventSemaphore(m_pServer, m_semaphoreDeleteEvt, ESP_GATTS_DELETE_EVT);
 			}
 			break;
 		} // ESP_GATTS_DELETE_EVT
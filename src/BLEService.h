@@ -11,6 +11,7 @@
 #if defined(CONFIG_BT_ENABLED)
 
 #include <esp_gatts_api.h>
+#include <vector>
 
 #include "BLECharacteristic.h"
 #include "BLEServer.h"
@@ -32,6 +33,8 @@ public:
 	BLECharacteristic* getByHandle(uint16_t handle);
 	BLECharacteristic* getFirst();
 	BLECharacteristic* getNext();
+	size_t getMemoryUsage();
+	void removeHandles();
 	std::string toString();
 	void handleGATTServerEvent(
 			esp_gatts_cb_event_t      event,
@@ -40,9 +43,10 @@ public:
 
 
 private:
-	std::map<BLECharacteristic*, std::string> m_uuidMap;
+	std::vector<BLECharacteristic*> m_characteristics;                       // In the order they were added.
+	std::vector<std::pair<BLEUUIDKey, BLECharacteristic*>> m_uuidIndex;     // Sorted by UUID key.
 	std::map<uint16_t, BLECharacteristic*> m_handleMap;
-	std::map<BLECharacteristic*, std::string>::iterator m_iterator;
+	size_t m_iterator = 0;
 };
 
 
@@ -60,6 +64,7 @@ public:
 	void			   executeDelete();
 	BLECharacteristic* getCharacteristic(const char* uuid);
 	BLECharacteristic* getCharacteristic(BLEUUID uuid);
+	size_t             getMemoryUsage();
 	BLEUUID            getUUID();
 	BLEServer*         getServer();
 	void               start();
@@ -89,13 +94,19 @@ private:
 	FreeRTOS::Semaphore  m_semaphoreStopEvt   = FreeRTOS::Semaphore("StopEvt");
 
 	uint32_t             m_numHandles;
+	bool                 m_useAttrTable;   // Create the whole service with a single attribute table at start().
+	std::vector<esp_gatts_attr_db_t> m_attrTable;
 
+	void               buildAttrTable();
+	void               executeCreateTable();
+	void               resetHandles();
 	BLECharacteristic* getLastCreatedCharacteristic();
 	void               handleGATTServerEvent(
 		esp_gatts_cb_event_t      event,
 		esp_gatt_if_t             gatts_if,
 		esp_ble_gatts_cb_param_t* param);
 	void               setHandle(uint16_t handle);
+	void               setHandlesFromTable(uint16_t* pHandles, uint16_t numHandles);
 	//void               setService(esp_gatt_srvc_id_t srvc_id);
 }; // BLEService
 
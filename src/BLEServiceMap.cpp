@@ -8,8 +8,19 @@
 #if defined(CONFIG_BT_ENABLED)
 #include <sstream>
 #include <iomanip>
+#include <algorithm>
 #include "BLEService.h"
 
+static const size_t MAP_NODE_OVERHEAD = 4 * sizeof(void*);   // Colour and links of a std::map node.
+
+
+/**
+ * @brief Order UUID index entries by their key.
+ */
+static bool compareKey(const std::pair<BLEUUIDKey, BLEService*>& entry, const BLEUUIDKey& key) {
+	return entry.first < key;
+} // compareKey
+
 
 /**
  * @brief Return the service by UUID.
@@ -26,12 +37,11 @@ BLEService* BLEServiceMap::getByUUID(const char* uuid) {
  * @return The characteristic.
  */
 BLEService* BLEServiceMap::getByUUID(BLEUUID uuid) {
-	for (auto &myPair : m_uuidMap) {
-		if (myPair.first->getUUID().equals(uuid)) {
-			return myPair.first;
-		}
+	BLEUUIDKey key = uuid.getKey();
+	auto it = std::lower_bound(m_uuidIndex.begin(), m_uuidIndex.end(), key, compareKey);
+	if (it != m_uuidIndex.end() && it->first == key) {
+		return it->second;
 	}
-	//return m_uuidMap.at(uuid.toString());
 	return nullptr;
 } // getByUUID
 
@@ -54,7 +64,15 @@ BLEService* BLEServiceMap::getByHandle(uint16_t handle) {
  */
 void BLEServiceMap::setByUUID(BLEUUID uuid,
 		BLEService *service) {
-	m_uuidMap.insert(std::pair<BLEService *, std::string>(service, uuid.toString()));
+	if (std::find(m_services.begin(), m_services.end(), service) != m_services.end()) {
+		return;
+	}
+	m_services.push_back(service);
+	// Services sharing a UUID are kept in the order they were added.
+	BLEUUIDKey key = uuid.getKey();
+	auto it = std::upper_bound(m_uuidIndex.begin(), m_uuidIndex.end(), key,
+		[](const BLEUUIDKey& k, const std::pair<BLEUUIDKey, BLEService*>& entry) { return k < entry.first; });
+	m_uuidIndex.insert(it, std::pair<BLEUUIDKey, BLEService*>(key, service));
 } // setByUUID
 
 
@@ -66,7 +84,7 @@ void BLEServiceMap::setByUUID(BLEUUID uuid,
  */
 void BLEServiceMap::setByHandle(uint16_t handle,
 		BLEService* service) {
-	m_handleMap.insert(std::pair<uint16_t, BLEService *>(handle, service));
+	m_handleMap[handle] = service;   // The stack may reuse the handle of a deleted service.
 } // setByHandle
 
 
@@ -88,8 +106,8 @@ void BLEServiceMap::handleGATTServerEvent(
 		esp_gatt_if_t             gatts_if,
 		esp_ble_gatts_cb_param_t *param) {
 	// Invoke the handler for every Service we have.
-	for (auto &myPair : m_uuidMap) {
-		myPair.first->handleGATTServerEvent(event, gatts_if, param);
+	for (size_t i = 0; i < m_services.size(); i++) {
+		m_services[i]->handleGATTServerEvent(event, gatts_if, param);
 	}
 }
 
@@ -98,13 +116,8 @@ void BLEServiceMap::handleGATTServerEvent(
  * @return The first service in the map.
  */
 BLEService* BLEServiceMap::getFirst() {
-	m_iterator = m_uuidMap.begin();
-	if (m_iterator == m_uuidMap.end()) {
-		return nullptr;
-	}
-	BLEService* pRet = m_iterator->first;
-	m_iterator++;
-	return pRet;
+	m_iterator = 0;
+	return getNext();
 } // getFirst
 
 /**
@@ -112,21 +125,36 @@ BLEService* BLEServiceMap::getFirst() {
  * @return The next service in the map.
  */
 BLEService* BLEServiceMap::getNext() {
-	if (m_iterator == m_uuidMap.end()) {
+	if (m_iterator >= m_services.size()) {
 		return nullptr;
 	}
-	BLEService* pRet = m_iterator->first;
-	m_iterator++;
-	return pRet;
+	return m_services[m_iterator++];
 } // getNext
 
+/**
+ * @brief Get the heap used by the map itself.
+ * @return The size of the containers, not including the services.
+ */
+size_t BLEServiceMap::getMemoryUsage() {
+	return m_services.capacity() * sizeof(BLEService*) +
+		m_uuidIndex.capacity() * sizeof(std::pair<BLEUUIDKey, BLEService*>) +
+		m_handleMap.size() * (MAP_NODE_OVERHEAD + sizeof(std::pair<const uint16_t, BLEService*>));
+} // getMemoryUsage
+
+
 /**
  * @brief Removes service from maps.
  * @return N/A.
  */
 void BLEServiceMap::removeService(BLEService *service){
 	m_handleMap.erase(service->getHandle());
-	m_uuidMap.erase(service);
+	m_services.erase(std::remove(m_services.begin(), m_services.end(), service), m_services.end());
+	for (auto it = m_uuidIndex.begin(); it != m_uuidIndex.end(); ++it) {
+		if (it->second == service) {
+			m_uuidIndex.erase(it);
+			break;
+		}
+	}
 } // removeService
 
 #endif /* CONFIG_BT_ENABLED */
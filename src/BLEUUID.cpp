@@ -229,7 +229,7 @@ bool BLEUUID::equals(BLEUUID uuid) {
 	}
 
 	if (uuid.m_uuid.len != m_uuid.len) {
-		return uuid.toString() == toString();
+		return uuid.getKey() == getKey();
 	}
 
 	if (uuid.m_uuid.len == ESP_UUID_LEN_16) {
@@ -289,6 +289,24 @@ esp_bt_uuid_t* BLEUUID::getNative() {
 } // getNative
 
 
+/**
+ * @brief Get the canonical 128 bit key of the UUID.
+ * An unset UUID has an all zero key.
+ * @return The key of the UUID.
+ */
+BLEUUIDKey BLEUUID::getKey() {
+	BLEUUIDKey key;
+	if (m_valueSet == false) {
+		memset(key.value, 0, sizeof(key.value));
+		return key;
+	}
+	BLEUUID full = *this;   // to128() converts in place so work on a copy.
+	full.to128();
+	memcpy(key.value, full.m_uuid.uuid.uuid128, sizeof(key.value));
+	return key;
+} // getKey
+
+
 /**
  * @brief Convert a UUID to its 128 bit representation.
  *
@@ -11,6 +11,21 @@
 #if defined(CONFIG_BT_ENABLED)
 #include <esp_gatt_defs.h>
 #include <string>
+#include <string.h>
+
+/**
+ * @brief The canonical 128 bit form of a %BLE UUID.
+ *
+ * 16 and 32 bit UUIDs are expanded with the Bluetooth base UUID so that equal UUIDs have equal keys
+ * whatever their original size.  Keys are ordered and can be compared without any string formatting.
+ */
+struct BLEUUIDKey {
+	uint8_t value[16];   // LSB first, as in esp_bt_uuid_t.
+
+	bool operator<(const BLEUUIDKey& other) const { return memcmp(value, other.value, sizeof(value)) < 0; }
+	bool operator==(const BLEUUIDKey& other) const { return memcmp(value, other.value, sizeof(value)) == 0; }
+}; // BLEUUIDKey
+
 
 /**
  * @brief A model of a %BLE UUID.
@@ -26,6 +41,7 @@ public:
 	BLEUUID();
 	int            bitSize();   // Get the number of bits in this uuid.
 	bool           equals(BLEUUID uuid);
+	BLEUUIDKey     getKey();
 	esp_bt_uuid_t* getNative();
 	BLEUUID        to128();
 	std::string    toString();
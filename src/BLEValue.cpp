@@ -8,6 +8,8 @@
 #if defined(CONFIG_BT_ENABLED)
 
 #include <esp_log.h>
+#include <stdlib.h>
+#include <string.h>
 
 #include "BLEValue.h"
 #ifdef ARDUINO_ARCH_ESP32
@@ -18,11 +20,20 @@ static const char* LOG_TAG="BLEValue";
 
 BLEValue::BLEValue() {
 	m_accumulation = "";
-	m_value        = "";
 	m_readOffset   = 0;
+	m_pData        = m_inline;
+	m_length       = 0;
+	m_capacity     = INLINE_SIZE;
 } // BLEValue
 
 
+BLEValue::~BLEValue() {
+	if (m_pData != m_inline) {
+		free(m_pData);
+	}
+} // ~BLEValue
+
+
 /**
  * @brief Add a message part to the accumulation.
  * The accumulation is a growing set of data that is added to until a commit or cancel.
@@ -68,7 +79,7 @@ void BLEValue::commit() {
 	if (m_accumulation.length() == 0) {
 		return;
 	}
-	setValue(m_accumulation);
+	setValue((uint8_t*)m_accumulation.data(), m_accumulation.length());
 	m_accumulation = "";
 	m_readOffset   = 0;
 } // commit
@@ -79,8 +90,17 @@ void BLEValue::commit() {
  * @return A pointer to the data.
  */
 uint8_t* BLEValue::getData() {
-	return (uint8_t*)m_value.data();
-}
+	return m_pData;
+} // getData
+
+
+/**
+ * @brief Get the heap used by the value.
+ * @return The size of the heap buffer, or 0 while the value fits in the inline storage.
+ */
+size_t BLEValue::getHeapSize() {
+	return m_pData != m_inline ? m_capacity : 0;
+} // getHeapSize
 
 
 /**
@@ -88,7 +108,7 @@ uint8_t* BLEValue::getData() {
  * @return The length of the data in bytes.
  */
 size_t BLEValue::getLength() {
-	return m_value.length();
+	return m_length;
 } // getLength
 
 
@@ -101,11 +121,21 @@ uint16_t BLEValue::getReadOffset() {
 } // getReadOffset
 
 
+/**
+ * @brief Get a view of the current value without copying it.
+ * @return A span over the current value.  It is only valid until the value is next changed.
+ */
+BLESpan BLEValue::getSpan() {
+	return BLESpan(m_pData, m_length);
+} // getSpan
+
+
 /**
  * @brief Get the current value.
+ * @return A copy of the current value.
  */
 std::string BLEValue::getValue() {
-	return m_value;
+	return std::string((char*)m_pData, m_length);
 } // getValue
 
 
@@ -122,7 +152,7 @@ void BLEValue::setReadOffset(uint16_t readOffset) {
  * @brief Set the current value.
  */
 void BLEValue::setValue(std::string value) {
-	m_value = value;
+	setValue((uint8_t*)value.data(), value.length());
 } // setValue
 
 
@@ -131,12 +161,20 @@ void BLEValue::setValue(std::string value) {
  * @param [in] pData The data for the current value.
  * @param [in] The length of the new current value.
  */
-void BLEValue::setValue(uint8_t* pData, size_t length) {
-	m_value = std::string((char*)pData, length);
+void BLEValue::setValue(const uint8_t* pData, size_t length) {
+	if (length > m_capacity) {
+		// Grow the storage.  We never shrink it so a value that keeps the same size is always updated in place.
+		uint8_t* pNew = (uint8_t*)realloc(m_pData == m_inline ? nullptr : m_pData, length);
+		if (pNew == nullptr) {
+			ESP_LOGE(LOG_TAG, "setValue: unable to allocate %d bytes", length);
+			return;
+		}
+		m_pData    = pNew;
+		m_capacity = length;
+	}
+	memmove(m_pData, pData, length);
+	m_length = length;
 } // setValue
 
 
-
-
-
 #endif // CONFIG_BT_ENABLED
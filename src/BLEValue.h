@@ -9,30 +9,65 @@
 #define COMPONENTS_CPP_UTILS_BLEVALUE_H_
 #include "sdkconfig.h"
 #if defined(CONFIG_BT_ENABLED)
+#include <stdint.h>
+#include <stddef.h>
 #include <string>
 
+/**
+ * @brief A non-owning view of a run of bytes.
+ *
+ * A span does not copy the data that it describes.  It is only valid until the owner of the
+ * data next changes it.
+ */
+class BLESpan {
+public:
+	BLESpan(const uint8_t* pData = nullptr, size_t length = 0) : m_pData(pData), m_length(length) {}
+	const uint8_t* data() const   { return m_pData; }   // Get a pointer to the first byte.
+	size_t         length() const { return m_length; }  // Get the number of bytes.
+
+private:
+	const uint8_t* m_pData;
+	size_t         m_length;
+}; // BLESpan
+
+
 /**
  * @brief The model of a %BLE value.
+ *
+ * The value is held in a buffer owned by this object.  Small values live in storage embedded in the
+ * object itself and larger values in a heap buffer which is only ever grown.  Once the buffer is large
+ * enough, setting a new value is a copy into the existing storage and does not touch the heap.
  */
 class BLEValue {
 public:
 	BLEValue();
+	~BLEValue();
 	void        addPart(std::string part);
 	void        addPart(uint8_t* pData, size_t length);
 	void        cancel();
 	void        commit();
 	uint8_t*    getData();
+	size_t      getHeapSize();
 	size_t      getLength();
 	uint16_t    getReadOffset();
+	BLESpan     getSpan();
 	std::string getValue();
 	void        setReadOffset(uint16_t readOffset);
 	void        setValue(std::string value);
-	void        setValue(uint8_t* pData, size_t length);
+	void        setValue(const uint8_t* pData, size_t length);
+
+	static const size_t INLINE_SIZE = 20; // Values up to this size never use the heap (default ATT MTU - 3).
 
 private:
+	BLEValue(const BLEValue&) = delete;
+	BLEValue& operator=(const BLEValue&) = delete;
+
 	std::string m_accumulation;
 	uint16_t    m_readOffset;
-	std::string m_value;
+	uint8_t*    m_pData;       // Either m_inline or a heap buffer of m_capacity bytes.
+	size_t      m_length;
+	size_t      m_capacity;
+	uint8_t     m_inline[INLINE_SIZE];
 };
 #endif // CONFIG_BT_ENABLED
 #endif /* COMPONENTS_CPP_UTILS_BLEVALUE_H_ */
@@ -16,6 +16,8 @@
 
 static const char* LOG_TAG = "FreeRTOS";
 
+static portMUX_TYPE semaphoreCreateMux = portMUX_INITIALIZER_UNLOCKED;
+
 /**
  * Sleep for the specified number of milliseconds.
  * @param[in] ms The period in milliseconds for which to sleep.
@@ -82,6 +84,7 @@ uint32_t FreeRTOS::Semaphore::wait(std::string owner) {
 	if (m_usePthreads) {
 		pthread_mutex_lock(&m_pthread_mutex);
 	} else {
+		create();
 		xSemaphoreTake(m_semaphore, portMAX_DELAY);
 	}
 
@@ -104,7 +107,7 @@ FreeRTOS::Semaphore::Semaphore(std::string name) {
 	if (m_usePthreads) {
 		pthread_mutex_init(&m_pthread_mutex, nullptr);
 	} else {
-		m_semaphore = xSemaphoreCreateMutex();
+		m_semaphore = nullptr;   // Created on first take, most semaphores are never used.
 	}
 
 	m_name      = name;
@@ -116,12 +119,41 @@ FreeRTOS::Semaphore::Semaphore(std::string name) {
 FreeRTOS::Semaphore::~Semaphore() {
 	if (m_usePthreads) {
 		pthread_mutex_destroy(&m_pthread_mutex);
-	} else {
+	} else if (m_semaphore != nullptr) {
 		vSemaphoreDelete(m_semaphore);
 	}
 }
 
 
+/**
+ * @brief Create the underlying %FreeRTOS mutex if it doesn't exist yet.
+ */
+void FreeRTOS::Semaphore::create() {
+	if (m_semaphore != nullptr) {
+		return;
+	}
+	SemaphoreHandle_t semaphore = xSemaphoreCreateMutex();
+	portENTER_CRITICAL(&semaphoreCreateMux);
+	if (m_semaphore == nullptr) {
+		m_semaphore = semaphore;
+		semaphore   = nullptr;
+	}
+	portEXIT_CRITICAL(&semaphoreCreateMux);
+	if (semaphore != nullptr) {   // Another task created it first.
+		vSemaphoreDelete(semaphore);
+	}
+} // create
+
+
+/**
+ * @brief Get the heap used by the semaphore.
+ * @return The size of the %FreeRTOS mutex, or 0 if it has not been created yet.
+ */
+size_t FreeRTOS::Semaphore::getHeapSize() {
+	return m_semaphore != nullptr ? sizeof(StaticQueue_t) : 0;
+} // getHeapSize
+
+
 /**
  * @brief Give a semaphore.
  * The Semaphore is given.
@@ -130,7 +162,7 @@ void FreeRTOS::Semaphore::give() {
 	ESP_LOGV(LOG_TAG, "Semaphore giving: %s", toString().c_str());
 	if (m_usePthreads) {
 		pthread_mutex_unlock(&m_pthread_mutex);
-	} else {
+	} else if (m_semaphore != nullptr) {   // A mutex that was never taken is already free.
 		xSemaphoreGive(m_semaphore);
 	}
 // #ifdef ARDUINO_ARCH_ESP32
@@ -159,7 +191,7 @@ void FreeRTOS::Semaphore::giveFromISR() {
 	BaseType_t higherPriorityTaskWoken;
 	if (m_usePthreads) {
 		assert(false);
-	} else {
+	} else if (m_semaphore != nullptr) {
 		xSemaphoreGiveFromISR(m_semaphore, &higherPriorityTaskWoken);
 	}
 } // giveFromISR
@@ -178,6 +210,7 @@ bool FreeRTOS::Semaphore::take(std::string owner)
 	if (m_usePthreads) {
 		pthread_mutex_lock(&m_pthread_mutex);
 	} else {
+		create();
 		rc = ::xSemaphoreTake(m_semaphore, portMAX_DELAY);
 	}
 	m_owner = owner;
@@ -204,6 +237,7 @@ bool FreeRTOS::Semaphore::take(uint32_t timeoutMs, std::string owner) {
 	if (m_usePthreads) {
 		assert(false);  // We apparently don't have a timed wait for pthreads.
 	} else {
+		create();
 		rc = ::xSemaphoreTake(m_semaphore, timeoutMs/portTICK_PERIOD_MS);
 	}
 	m_owner = owner;
@@ -38,10 +38,13 @@ public:
 		void        setName(std::string name);
 		bool        take(std::string owner="<Unknown>");
 		bool        take(uint32_t timeoutMs, std::string owner="<Unknown>");
+		size_t      getHeapSize();
 		std::string toString();
 		uint32_t    wait(std::string owner="<Unknown>");
 
 	private:
+		void        create();
+
 		SemaphoreHandle_t m_semaphore;
 		pthread_mutex_t   m_pthread_mutex;
 		std::string       m_name;